@@ -59,6 +59,11 @@
           "-L/opt/homebrew/lib",
           "-ldl"
         ],
+        "conditions": [
+          ['OS=="linux"', {
+            "libraries": ["-lrt"]
+          }]
+        ],
         "defines": [
           "NAPI_DISABLE_CPP_EXCEPTIONS"
         ]
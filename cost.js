@@ -0,0 +1,44 @@
+// Post-response cost charging.
+//
+// A request is admitted for one token, but its real cost is only known once
+// the response has finished. The charger measures how long the handler took
+// and charges the difference to the limiter with chargeAsync(), which may
+// leave the bucket in debt: the client is then throttled until refills repay
+// it. Local limiters are charged during the call; limiters backed by Redis or
+// NATS are charged off the event loop.
+
+function ignore() {}
+
+// cost is either a number of extra tokens per second of handler time, or a
+// function (req, res, durationMs) => extra tokens.
+function createCostCharger(limiter, cost) {
+    const extraCost = typeof cost === 'function' ?
+        cost :
+        (req, res, durationMs) => durationMs * cost / 1000;
+
+    // emitter is the underlying response stream when res is a framework
+    // wrapper that does not emit 'finish' itself (fastify's reply)
+    return function track(req, res, key, emitter = res) {
+        const start = process.hrtime.bigint();
+        // 'close' also covers aborted responses, which never finish but still
+        // cost handler time; whichever comes first charges
+        const settle = () => {
+            emitter.removeListener('finish', settle);
+            emitter.removeListener('close', settle);
+            const durationMs = Number(process.hrtime.bigint() - start) / 1e6;
+            // The response is already sent; a failed charge only loses accounting
+            try {
+                const extra = Math.floor(extraCost(req, res, durationMs));
+                if (extra > 0) {
+                    limiter.chargeAsync(key, extra).catch(ignore);
+                }
+            } catch (e) {
+                // extraCost threw
+            }
+        };
+        emitter.once('finish', settle);
+        emitter.once('close', settle);
+    };
+}
+
+module.exports = { createCostCharger };
@@ -0,0 +1,79 @@
+// Multi-threaded comparison of the CAS-loop consume against the wait-free
+// fetch_sub consume used by the rate limiter.
+//
+//   npm run benchmark:consume
+//
+// Every thread hammers the same bucket, which starts with more tokens than
+// the run can spend, so the numbers measure the allow path under contention.
+// A second round starts with a small bucket to check that the overdraft
+// correction never admits more requests than there were tokens.
+
+#include "ratelimiter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static bool casConsume(std::atomic<int64_t>& tokens) {
+    int64_t current;
+    do {
+        current = tokens.load(std::memory_order_acquire);
+        if (current <= 0) return false;
+    } while (!tokens.compare_exchange_weak(current, current - 1,
+            std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+}
+
+static bool fetchSubConsume(std::atomic<int64_t>& tokens) {
+    return tryTakeTokens(tokens, 1);
+}
+
+template<typename Consume>
+static void run(const char* name, Consume consume, unsigned threads, int64_t initial, int64_t perThread) {
+    std::atomic<int64_t> tokens{initial};
+    std::atomic<int64_t> allowed{0};
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            int64_t local = 0;
+            for (int64_t i = 0; i < perThread; i++) {
+                if (consume(tokens)) local++;
+            }
+            allowed.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    int64_t total = static_cast<int64_t>(threads) * perThread;
+    std::printf("  %-10s threads=%-3u %9.1f ms  %7.1f Mops/s  allowed=%lld tokens=%lld\n",
+                name, threads, ms, total / ms / 1000.0,
+                static_cast<long long>(allowed.load()), static_cast<long long>(tokens.load()));
+}
+
+int main() {
+    const int64_t perThread = 5000000;
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<unsigned> threadCounts{1};
+    for (unsigned t = 2; t <= hardware * 2; t *= 2) threadCounts.push_back(t);
+
+    std::printf("Contended allow path (%u hardware threads)\n", hardware);
+    for (unsigned threads : threadCounts) {
+        int64_t initial = static_cast<int64_t>(threads) * perThread;
+        run("cas", casConsume, threads, initial, perThread);
+        run("fetch_sub", fetchSubConsume, threads, initial, perThread);
+    }
+
+    std::printf("\nExhausted bucket (10000 tokens, allowed must equal 10000)\n");
+    for (unsigned threads : threadCounts) {
+        run("cas", casConsume, threads, 10000, perThread / 10);
+        run("fetch_sub", fetchSubConsume, threads, 10000, perThread / 10);
+    }
+    return 0;
+}
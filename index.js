@@ -6,8 +6,21 @@ module.exports = hyperlimit;
 // Also export the DistributedStorage base class for extensions
 class DistributedStorage {
     constructor() {}
-    tryAcquire(key, tokens) { throw new Error('Not implemented'); }
+    tryAcquire(key, maxTokens, cost) { throw new Error('Not implemented'); }
     release(key, tokens) { throw new Error('Not implemented'); }
 }
 
-hyperlimit.DistributedStorage = DistributedStorage; 
\ No newline at end of file
+hyperlimit.DistributedStorage = DistributedStorage;
+
+// Bandwidth shaping helpers used by the middleware packages
+const { Pacer, paceResponse, paceRequest, createBandwidthShaper } = require('./pacing');
+
+hyperlimit.Pacer = Pacer;
+hyperlimit.paceResponse = paceResponse;
+hyperlimit.paceRequest = paceRequest;
+hyperlimit.createBandwidthShaper = createBandwidthShaper;
+
+// Post-response cost charging used by the middleware packages
+const { createCostCharger } = require('./cost');
+
+hyperlimit.createCostCharger = createCostCharger;
@@ -0,0 +1,194 @@
+// Bandwidth shaping for streamed request and response bodies.
+//
+// Each chunk is charged to a native bandwidth limiter with consumeBytes(),
+// which answers with how long the chunk has to wait. Waiting chunks are
+// released by a Pacer that groups deadlines into fixed time slots, so a busy
+// server arms one timer per slot instead of one setTimeout per chunk.
+
+class Pacer {
+    constructor(resolutionMs = 10) {
+        this.resolutionMs = Math.max(1, resolutionMs);
+        this.slots = new Map();
+        this.timer = null;
+        this.armedSlot = Infinity;
+    }
+
+    schedule(delayMs, callback) {
+        const slot = Math.ceil((Date.now() + delayMs) / this.resolutionMs);
+        const callbacks = this.slots.get(slot);
+        if (callbacks) {
+            callbacks.push(callback);
+        } else {
+            this.slots.set(slot, [callback]);
+        }
+        if (slot < this.armedSlot) {
+            this.arm(slot);
+        }
+    }
+
+    arm(slot) {
+        if (this.timer) clearTimeout(this.timer);
+        this.armedSlot = slot;
+        this.timer = setTimeout(() => this.fire(), Math.max(0, slot * this.resolutionMs - Date.now()));
+    }
+
+    fire() {
+        this.timer = null;
+        this.armedSlot = Infinity;
+
+        const now = Date.now();
+        const due = [];
+        for (const slot of this.slots.keys()) {
+            if (slot * this.resolutionMs <= now) due.push(slot);
+        }
+
+        // Run earlier slots first so chunks leave in the order they were queued
+        due.sort((a, b) => a - b);
+        for (const slot of due) {
+            const callbacks = this.slots.get(slot);
+            this.slots.delete(slot);
+            for (const callback of callbacks) callback();
+        }
+
+        // Callbacks may have scheduled new work and armed the timer themselves
+        let next = Infinity;
+        for (const slot of this.slots.keys()) {
+            if (slot < next) next = slot;
+        }
+        if (next !== Infinity && next < this.armedSlot) {
+            this.arm(next);
+        }
+    }
+}
+
+function byteLength(chunk, encoding) {
+    if (typeof chunk === 'string') {
+        return Buffer.byteLength(chunk, typeof encoding === 'string' ? encoding : 'utf8');
+    }
+    if (chunk && typeof chunk.byteLength === 'number') {
+        return chunk.byteLength;
+    }
+    return 0;
+}
+
+// Delay write() and end() calls on a response until the limiter allows their
+// bytes. Queued writes report backpressure and 'drain' is emitted once the
+// queue empties, so well-behaved producers slow down with the pacing.
+function paceResponse(res, limiter, key, pacer) {
+    const write = res.write;
+    const end = res.end;
+    const queue = [];
+    let backpressure = false;
+
+    function flush() {
+        const now = Date.now();
+        while (queue.length > 0 && queue[0].due <= now) {
+            const { method, args } = queue.shift();
+            method.apply(res, args);
+        }
+        if (queue.length > 0) {
+            pacer.schedule(queue[0].due - now, flush);
+        } else if (backpressure) {
+            backpressure = false;
+            res.emit('drain');
+        }
+    }
+
+    function pace(method, args) {
+        const bytes = byteLength(args[0], args[1]);
+        const delay = bytes > 0 ? limiter.consumeBytes(key, bytes) : 0;
+        if (delay === 0 && queue.length === 0) {
+            return method.apply(res, args);
+        }
+        queue.push({ method, args, due: Date.now() + delay });
+        if (queue.length === 1) {
+            pacer.schedule(delay, flush);
+        }
+        backpressure = true;
+        return false;
+    }
+
+    res.write = function pacedWrite(...args) {
+        return pace(write, args);
+    };
+    res.end = function pacedEnd(...args) {
+        const result = pace(end, args);
+        return result === false ? res : result;
+    };
+
+    if (typeof res.once === 'function') {
+        // Nothing left to send once the client is gone
+        res.once('close', () => { queue.length = 0; });
+    }
+}
+
+// Pause a flowing request body after each chunk that overdraws the limiter.
+// While paused, the stream buffers fill up and the socket stops reading, so
+// the client is slowed down by TCP backpressure.
+function paceRequest(req, limiter, key, pacer) {
+    const emit = req.emit;
+    req.emit = function pacedEmit(event, chunk) {
+        if (event === 'data') {
+            const bytes = byteLength(chunk);
+            const delay = bytes > 0 ? limiter.consumeBytes(key, bytes) : 0;
+            if (delay > 0 && this.readableFlowing) {
+                this.pause();
+                pacer.schedule(delay, () => this.resume());
+            }
+        }
+        return emit.apply(this, arguments);
+    };
+}
+
+// Shaper limiters live in the limiter's table next to the user's own. The
+// unit separator keeps their keys apart from any key a user would pick.
+const KEY_PREFIX = 'bandwidth\x1f';
+
+// Middleware helper: options.download and options.upload are bytes per
+// second per client, options.burst the bytes a client may send at once
+// (defaults to one second of traffic). Limiters are made per client on
+// demand, so run the limiter with maintenance and an idleTimeout to evict
+// those of clients that went quiet.
+function createBandwidthShaper(limiter, options = {}) {
+    const { download = 0, upload = 0, burst, resolution = 10 } = options;
+    const pacer = new Pacer(resolution);
+
+    // Stands in for the limiter in paceResponse and paceRequest. A limiter
+    // evicted while its body was idle is recreated, full, on the next chunk.
+    function direction(name, bytesPerSecond) {
+        const prefix = `${KEY_PREFIX}${name}\x1f`;
+        const ensure = key => limiter.ensureBandwidthLimiter(key, bytesPerSecond, burst || bytesPerSecond);
+        return {
+            keyFor(clientKey) {
+                const key = prefix + clientKey;
+                ensure(key);
+                return key;
+            },
+            consumeBytes(key, bytes) {
+                try {
+                    return limiter.consumeBytes(key, bytes);
+                } catch (err) {
+                    // ensure() only recreates a limiter that is missing
+                    if (!ensure(key)) throw err;
+                    return limiter.consumeBytes(key, bytes);
+                }
+            }
+        };
+    }
+    const downloads = download > 0 ? direction('download', download) : null;
+    const uploads = upload > 0 ? direction('upload', upload) : null;
+
+    return {
+        pacer,
+        pace(req, res, clientKey) {
+            if (downloads) {
+                paceResponse(res, downloads, downloads.keyFor(clientKey), pacer);
+            }
+            if (uploads) {
+                paceRequest(req, uploads, uploads.keyFor(clientKey), pacer);
+            }
+        }
+    };
+}
+
+module.exports = { Pacer, paceResponse, paceRequest, createBandwidthShaper };
@@ -1,4 +1,8 @@
-const { HyperLimit } = require('@hyperlimit/core');
+const { HyperLimit, createBandwidthShaper, createCostCharger } = require('@hyperlimit/core');
+
+// Results of limiter.decide()
+const ALLOWED = 1;
+const BYPASSED = 2;
 
 function rateLimit(options = {}) {
     const {
@@ -10,18 +14,51 @@ function rateLimit(options = {}) {
         key = 'default',
         bypassHeader,
         bypassKeys = [],
+        legacyHeaders = true,
+        standardHeaders = false,
         keyGenerator,
         configResolver,
         onRejected,
+        rules,
+        bandwidth,
+        cost,
         redis,
-        nats
+        nats,
+        maintenance,
+        clock
     } = options;
 
     // Create limiter instance with distributed storage if configured
-    const limiterOptions = {};
+    // decide writes allowed, limit, remaining, reset (Unix seconds) and
+    // retryAfter (seconds) here, so no info object is allocated per request
+    const info = new Float64Array(5);
+    const limiterOptions = { infoArray: info };
     if (redis) limiterOptions.redis = redis;
     if (nats) limiterOptions.nats = nats;
-    const limiter = new HyperLimit(Object.keys(limiterOptions).length > 0 ? limiterOptions : undefined);
+    if (clock) limiterOptions.clock = clock;
+    // Rules and bandwidth shaping create limiters per client on demand; sweep
+    // out idle ones so the table does not keep one for every client ever
+    // seen. maintenance: false turns this off.
+    const sweep = maintenance !== undefined ? maintenance : (rules || bandwidth ? { idleTimeout: 600000 } : null);
+    if (sweep) limiterOptions.maintenance = sweep;
+    const limiter = new HyperLimit(limiterOptions);
+
+    // Rules are compiled natively once; each request is then matched, keyed
+    // and given its limit without a JS resolver
+    if (rules) {
+        limiter.loadRules(rules.map(rule => ({
+            ...rule,
+            window: parseDuration(rule.window || window),
+            block: rule.block ? parseDuration(rule.block) : 0,
+            sliding: rule.sliding !== undefined ? rule.sliding : sliding
+        })));
+    }
+
+    // Per-client byte-rate shaping of request and response bodies
+    const shaper = bandwidth ? createBandwidthShaper(limiter, bandwidth) : null;
+
+    // Extra tokens charged once the response has finished
+    const trackCost = cost ? createCostCharger(limiter, cost) : null;
 
     // If configResolver is provided, we'll create limiters dynamically
     // Otherwise, create a static limiter for backward compatibility
@@ -34,36 +71,49 @@ function rateLimit(options = {}) {
         limiter.createLimiter(key, maxTokens, windowMs, sliding, blockMs, maxPenalty, distributedKey);
     }
     
+    // Client identity for rules, configResolver and bandwidth shaping
+    function clientKeyOf(req) {
+        try {
+            return keyGenerator ? keyGenerator(req) : req.ip;
+        } catch (e) {
+            // If keyGenerator fails, fall back to IP
+            return req.ip;
+        }
+    }
+
+    // Bypass tokens are checked natively by decide; rules and configResolver
+    // also check them up front so bypassed requests resolve nothing
+    // decide also stores the header strings here, cached natively while the
+    // values are unchanged: X-RateLimit-Limit, -Remaining, -Reset (Unix
+    // seconds), then RateLimit-Policy and RateLimit
+    const headerValues = new Array(5);
+    limiter.configureDecide({ bypassKeys, headers: headerValues, legacyHeaders, standardHeaders });
+    const bypassHeaderName = bypassHeader ? bypassHeader.toLowerCase() : null;
+    const bypassSet = new Set(bypassKeys);
+
     // Cache for resolved configs to avoid excessive calls to configResolver
     const configCache = new Map();
     const CONFIG_CACHE_TTL = 60000; // 1 minute cache
 
     return function rateLimitMiddleware(req, res, next) {
         try {
-            // Check bypass keys if configured
-            if (bypassHeader) {
-                const bypassKey = req.headers[bypassHeader.toLowerCase()];
-                if (bypassKeys.includes(bypassKey)) {
-                    return next();
-                }
-            }
-
-            // Generate key if custom generator provided
-            let clientKey;
-            try {
-                clientKey = keyGenerator ? 
-                    keyGenerator(req) : 
-                    req.ip;
-            } catch (e) {
-                // If keyGenerator fails, fall back to IP
-                clientKey = req.ip;
-            }
+            const bypassToken = bypassHeaderName ? req.headers[bypassHeaderName] : undefined;
 
             // Determine the limiter key and config to use
             let limiterKey = key;
+            let clientKey;
+            if (rules || configResolver) {
+                if (bypassToken !== undefined && bypassSet.has(bypassToken)) {
+                    return next();
+                }
+                clientKey = clientKeyOf(req);
+            }
             let effectiveConfig = null;
+            const ruleKey = rules ? limiter.matchRule(req.method, req.path, req.headers, clientKey) : null;
             
-            if (configResolver) {
+            if (ruleKey !== null) {
+                limiterKey = ruleKey;
+            } else if (configResolver) {
                 // When using configResolver, always use clientKey as limiterKey
                 limiterKey = clientKey;
                 
@@ -94,9 +144,11 @@ function rateLimit(options = {}) {
                 
                 // If config is null or explicitly denies access, reject immediately
                 if (!effectiveConfig || effectiveConfig.deny || effectiveConfig.maxTokens === 0) {
-                    res.header('X-RateLimit-Limit', '0');
-                    res.header('X-RateLimit-Remaining', '0');
-                    res.header('X-RateLimit-Reset', String(Math.ceil(Date.now() / 1000)));
+                    if (legacyHeaders) {
+                        res.header('X-RateLimit-Limit', '0');
+                        res.header('X-RateLimit-Remaining', '0');
+                        res.header('X-RateLimit-Reset', String(Math.ceil(Date.now() / 1000)));
+                    }
                     
                     if (onRejected) {
                         return onRejected(req, res, {
@@ -137,39 +189,34 @@ function rateLimit(options = {}) {
                 }
             }
 
+            // Bypass check, decision and header values in one native call
+            const decision = limiter.decide(limiterKey, req.ip, bypassToken);
+            if (decision === BYPASSED) {
+                return next();
+            }
+
             // Attach limiter to request for potential use in route handlers
             req.rateLimit = { limiter, key: limiterKey };
 
-            const allowed = limiter.tryRequest(limiterKey, req.ip);
-            
-            // Get rate limit info after the request
-            let info;
-            try {
-                info = limiter.getRateLimitInfo(limiterKey);
-            } catch (e) {
-                // If limiter doesn't exist, use default values
-                const resolvedLimit = effectiveConfig?.maxTokens || maxTokens;
-                const resolvedWindow = effectiveConfig?.window || window;
-                info = {
-                    limit: resolvedLimit,
-                    remaining: 0,
-                    reset: Date.now() + parseDuration(resolvedWindow),
-                    blocked: false
-                };
-            }
-            
             // Set rate limit headers
-            res.header('X-RateLimit-Limit', String(info.limit));
-            res.header('X-RateLimit-Remaining', String(Math.max(0, info.remaining)));
-            res.header('X-RateLimit-Reset', String(Math.ceil(info.reset / 1000))); // Convert to seconds
-            
-            if (allowed) {
+            if (legacyHeaders) {
+                res.header('X-RateLimit-Limit', headerValues[0]);
+                res.header('X-RateLimit-Remaining', headerValues[1]);
+                res.header('X-RateLimit-Reset', headerValues[2]);
+            }
+            if (standardHeaders) {
+                res.header('RateLimit-Policy', headerValues[3]);
+                res.header('RateLimit', headerValues[4]);
+            }
+
+            if (decision === ALLOWED) {
+                if (shaper) shaper.pace(req, res, clientKey === undefined ? clientKeyOf(req) : clientKey);
+                if (trackCost) trackCost(req, res, limiterKey);
                 return next();
             }
 
-            // Calculate retryAfter based on resolved config or default
-            const configuredWindow = effectiveConfig ? parseDuration(effectiveConfig.window || window) : parseDuration(window);
-            const retryAfterSeconds = info.retryAfter || Math.ceil(configuredWindow / 1000);
+            // Seconds until the block ends, or the limiter's window
+            const retryAfterSeconds = info[4];
             
             // Return rejection info to be handled by custom handler
             if (onRejected) {
@@ -4,7 +4,8 @@ import { join } from 'path';
 interface RateLimitInfo {
     limit: number;
     remaining: number;
-    reset: number;
+    reset: number;      // ms on the limiter's monotonic clock
+    resetAt: number;    // Unix time in ms
     blocked: boolean;
     retryAfter?: string;
 }
@@ -17,12 +18,94 @@ interface MonitoringStats {
     allowRate: number;
     blockRate: number;
     penaltyRate: number;
+    heapStringCopies: number;
+}
+
+interface TableStats {
+    capacity: number;
+    limiters: number;
+    tombstones: number;
+    maxProbeLength: number;
+}
+
+interface FairShareInfo {
+    weight: number;
+    share: number;
+    used: number;
+    activeWeight: number;
+}
+
+interface LimitRule {
+    name?: string;
+    method?: string | string[];
+    path?: string;
+    headers?: Record<string, string>;
+    key?: string;
+    maxTokens: number;
+    window: number;
+    sliding?: boolean;
+    block?: number;
+    maxPenalty?: number;
+}
+
+// Opaque per-connection limiter state returned by createHandle
+interface LimiterHandle {
+    readonly __limiterHandle: unique symbol;
+}
+
+// Opaque table of integer-keyed limiters returned by createKeyTable
+interface KeyTable {
+    readonly __keyTable: unique symbol;
+}
+
+type KeyTableType = 'ipv4' | 'ipv6' | 'u64';
+
+// Opaque mapping of a shared-memory limiter table returned by openSharedTable
+interface SharedTable {
+    readonly __sharedTable: unique symbol;
+}
+
+interface SharedTableStats {
+    totalRequests: number;
+    allowedRequests: number;
+    blockedRequests: number;
+    limiters: number;
+    capacity: number;
+}
+
+// Limiter state transition delivered by onEvents; times are ms on the
+// limiter's clock
+type LimiterEvent =
+    | { type: 'block'; key: string; time: number; until: number }
+    | { type: 'unblock'; key: string; time: number }
+    | { type: 'penalty'; key: string; time: number; points: number };
+
+interface EventOptions {
+    interval?: number;
+    capacity?: number;
+}
+
+// Bypass tokens for decide, the settings of limiters it creates for
+// unknown keys when maxTokens is given, and where it writes header values:
+// X-RateLimit-Limit, -Remaining, -Reset, RateLimit-Policy and RateLimit
+interface DecideOptions {
+    bypassKeys?: string[];
+    maxTokens?: number;
+    window?: number;
+    sliding?: boolean;
+    block?: number;
+    maxPenalty?: number;
+    headers?: string[];
+    legacyHeaders?: boolean;
+    standardHeaders?: boolean;
 }
 
 interface RedisOptions {
     host?: string;
     port?: number;
     prefix?: string;
+    // Storage connections, each carrying one round trip at a time (default 4)
+    connections?: number;
 }
 
 interface NatsOptions {
@@ -30,10 +113,38 @@ interface NatsOptions {
     bucket?: string;
     prefix?: string;
     credentials?: string;
+    // Storage connections, each carrying one round trip at a time (default 4)
+    connections?: number;
+}
+
+interface ClockInfo {
+    source: 'steady' | 'coarse' | 'cached' | 'tsc' | 'manual';
+    resolution: 'ms' | 'us' | 'ns';
+}
+
+interface MaintenanceOptions {
+    interval?: number;
+    batch?: number;
+    idleTimeout?: number;
+}
+
+interface MaintenanceResult {
+    swept: number;
+    unblocked: number;
+    evicted: number;
 }
 
 interface HyperLimitOptions {
     bucketCount?: number;
+    clock?: 'steady' | 'coarse' | 'cached' | 'tsc' | 'manual';
+    clockTickMs?: number;
+    resolution?: 'ms' | 'us' | 'ns';
+    maintenance?: MaintenanceOptions;
+    // Receives [allowed, limit, remaining, reset, retryAfter] from tryRequestInfo
+    // and decide: reset as Unix seconds, retryAfter in seconds
+    infoArray?: Float64Array | BigInt64Array;
+    // Token from share() on another thread; attaches to that limiter
+    shared?: number;
     redis?: RedisOptions;
     nats?: NatsOptions;
 }
@@ -41,12 +152,45 @@ interface HyperLimitOptions {
 interface HyperLimitNative {
     HyperLimit: {
         new(options?: HyperLimitOptions): {
-            createLimiter(key: string, maxTokens: number, refillTimeMs: number, useSlidingWindow?: boolean, blockDurationMs?: number, maxPenaltyPoints?: number, distributedKey?: string): void;
+            createLimiter(key: string, maxTokens: number, refillTimeMs: number, useSlidingWindow: boolean, blockDurationMs: number, maxPenaltyPoints: number, distributedKey: string, withId: true): number;
+            createLimiter(key: string, maxTokens: number, refillTimeMs: number, useSlidingWindow?: boolean, blockDurationMs?: number, maxPenaltyPoints?: number, distributedKey?: string, withId?: boolean): void;
             tryRequest(key: string, ip?: string): boolean;
+            tryRequestAsync(key: string, ip?: string): Promise<boolean>;
+            tryRequestById(id: number): boolean;
+            tryRequestInfo(key: string, ip?: string): boolean;
+            configureDecide(options: DecideOptions): void;
+            // 1 allowed, 0 rejected, 2 bypassed; header values go to the infoArray
+            decide(key: string, ip?: string, bypassToken?: string): 0 | 1 | 2;
+            tryRequestBatch(keys: string[] | Buffer, costs?: number[] | Uint32Array): Uint8Array;
+            createHandle(maxTokens: number, refillTimeMs: number, useSlidingWindow?: boolean, blockDurationMs?: number, maxPenaltyPoints?: number): LimiterHandle;
+            consume(handle: LimiterHandle): boolean;
+            createKeyTable(type: KeyTableType, maxTokens: number, refillTimeMs: number, useSlidingWindow?: boolean, blockDurationMs?: number): KeyTable;
+            tryRequestKey(table: KeyTable, key: number | bigint | string | Buffer): boolean;
+            getKeyTokens(table: KeyTable, key: number | bigint | string | Buffer): number;
+            openSharedTable(name: string, capacity?: number): SharedTable;
+            createSharedLimiter(table: SharedTable, key: string, maxTokens: number, refillTimeMs: number, useSlidingWindow?: boolean, blockDurationMs?: number): void;
+            removeSharedLimiter(table: SharedTable, key: string): void;
+            tryRequestShared(table: SharedTable, key: string): boolean;
+            getSharedTokens(table: SharedTable, key: string): number;
+            getSharedStats(table: SharedTable): SharedTableStats;
+            setStriping(key: string, stripes: number, batch?: number): void;
+            loadRules(rules: LimitRule[]): void;
+            matchRule(method: string, path: string, headers?: Record<string, string | string[] | undefined>, client?: string): string | null;
             removeLimiter(key: string): void;
+            createBandwidthLimiter(key: string, bytesPerSecond: number, burstBytes?: number): void;
+            ensureBandwidthLimiter(key: string, bytesPerSecond: number, burstBytes?: number): boolean;
+            consumeBytes(key: string, bytes: number): number;
+            charge(key: string, cost: number): number;
+            // Resolves with charge's result; distributed limiters are charged off the event loop
+            chargeAsync(key: string, cost: number): Promise<number>;
             getTokens(key: string): number;
             getCurrentLimit(key: string): number;
             getRateLimitInfo(key: string): RateLimitInfo;
+            getRateLimitInfoAsync(key: string): Promise<RateLimitInfo>;
+            // For n keys: limit, remaining, reset, blocked and retryAfter, n values each
+            getInfoMany(keys: string[] | Buffer, into?: Float64Array): Float64Array;
+            getTokensById(id: number): number;
+            getInfoById(id: number): RateLimitInfo;
             addPenalty(key: string, points: number): void;
             removePenalty(key: string, points: number): void;
             addToWhitelist(ip: string): void;
@@ -55,15 +199,32 @@ interface HyperLimitNative {
             removeFromBlacklist(ip: string): void;
             isWhitelisted(ip: string): boolean;
             isBlacklisted(ip: string): boolean;
+            setTenantWeight(poolKey: string, tenant: string, weight: number): void;
+            tryRequestFairShare(poolKey: string, tenant: string): boolean;
+            getFairShareInfo(poolKey: string, tenant: string): FairShareInfo;
+            now(): number;
+            advanceTime(ms: number): number;
+            getClock(): ClockInfo;
+            runMaintenance(batch?: number, idleTimeout?: number): MaintenanceResult;
+            onEvents(callback: (events: LimiterEvent[], dropped: number) => void, options?: EventOptions): void;
+            offEvents(): void;
             getStats(): MonitoringStats;
+            // totalRequests, allowedRequests, blockedRequests, penalizedRequests,
+            // allowRate, blockRate, penaltyRate, heapStringCopies
+            getStats(into: Float64Array): Float64Array;
             resetStats(): void;
+            getTableStats(): TableStats;
+            share(): number;
         };
+        parseIp(text: string): Buffer | null;
+        unlinkSharedTable(name: string): boolean;
     };
 }
 
 // Define the distributed storage interface
 export abstract class DistributedStorage {
-    abstract tryAcquire(key: string, tokens: number): Promise<boolean>;
+    abstract tryAcquire(key: string, maxTokens: number, cost: number): Promise<boolean>;
+    // A negative tokens debits the bucket (charge() on a distributed limiter)
     abstract release(key: string, tokens: number): Promise<void>;
 }
 
@@ -77,4 +238,4 @@ try {
 
 // Export the native module and DistributedStorage
 export const HyperLimit = nativeModule.HyperLimit;
-export type { RateLimitInfo, MonitoringStats, HyperLimitOptions, RedisOptions, NatsOptions }; 
\ No newline at end of file
+export type { RateLimitInfo, MonitoringStats, TableStats, FairShareInfo, LimiterHandle, KeyTable, KeyTableType, SharedTable, SharedTableStats, LimitRule, LimiterEvent, EventOptions, DecideOptions, ClockInfo, MaintenanceOptions, MaintenanceResult, HyperLimitOptions, RedisOptions, NatsOptions }; 
\ No newline at end of file
@@ -0,0 +1,325 @@
+#pragma once
+
+#ifdef _WIN32
+#include "win_compat.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+// Where a limiter reads the time from. With millisecond windows a
+// nanosecond clock read per decision is wasted work on the hot path:
+//   Steady - std::chrono::steady_clock, the default
+//   Coarse - CLOCK_MONOTONIC_COARSE: no hardware counter read, resolution of
+//            one scheduler tick (1-4ms); steady_clock where unavailable
+//   Cached - a timestamp refreshed by a ticker thread every tickMs, so
+//            reading the time is a single relaxed load
+//   Tsc    - the CPU's invariant timestamp counter (the generic timer on
+//            arm64) scaled to nanoseconds; no system call or vDSO page.
+//            Steady where the CPU has no invariant counter.
+//   Manual - virtual time starting at zero that only moves when advance()
+//            is called, for simulations and tests
+// All other sources count from the same monotonic origin.
+enum class ClockSource : uint8_t {
+    Steady,
+    Coarse,
+    Cached,
+    Tsc,
+    Manual
+};
+
+// Unit of every timestamp and duration a limiter works with. Milliseconds
+// unless sub-millisecond windows are needed.
+enum class ClockResolution : uint8_t {
+    Milliseconds,
+    Microseconds,
+    Nanoseconds
+};
+
+// Timestamp counter scaled to steady_clock nanoseconds. The scale is
+// calibrated against steady_clock at startup and corrected periodically by
+// the owning Clock: each correction re-anchors at the current reading and
+// slews the rate so the remaining error is gone by the next correction.
+// Readers get the anchor through a seqlock, so a reading is the counter read
+// plus one multiply-add and never goes backwards across a correction.
+class TscClock {
+public:
+    static bool supported() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        // CPUID 0x80000007 EDX bit 8: the counter runs at a constant rate in
+        // every P-, C- and T-state
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0x80000000);
+        if (static_cast<unsigned>(regs[0]) < 0x80000007u) return false;
+        __cpuid(regs, 0x80000007);
+        return (regs[3] & (1 << 8)) != 0;
+#else
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007u) return false;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+        return (edx & (1u << 8)) != 0;
+#endif
+#elif defined(__aarch64__)
+        // The virtual counter always runs at a fixed frequency
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static uint64_t cycles() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return 0;
+#endif
+    }
+
+    static int64_t steadyNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    TscClock() : seq(0), baseCycles(0), baseNs(0), nsPerCycle(0) {}
+
+    // Measure the counter rate over a short sleep and anchor at the end of it
+    void calibrate() {
+        Sample start = sample();
+        std::this_thread::sleep_for(std::chrono::milliseconds(kCalibrationMs));
+        Sample end = sample();
+        publish(end.cycles, end.ns, rateBetween(start, end));
+        sync = end;
+    }
+
+    // Called every kCorrectionMs by the owning Clock's ticker thread
+    void correct() noexcept {
+        Sample now = sample();
+        double measured = rateBetween(sync, now);
+        int64_t current = toNs(now.cycles);
+        int64_t error = now.ns - current;
+
+        if (error > kStepNs) {
+            // Large gap, e.g. after a suspend: jump forward instead of slewing
+            publish(now.cycles, now.ns, measured);
+        } else {
+            // Keep the reading continuous and make up the error over the next
+            // interval, at most 0.1% faster or slower than the measured rate
+            double slew = static_cast<double>(error) / (kCorrectionMs * 1000000.0);
+            slew = slew > 0.001 ? 0.001 : (slew < -0.001 ? -0.001 : slew);
+            publish(now.cycles, current, measured * (1.0 + slew));
+        }
+        sync = now;
+    }
+
+    int64_t nowNs() const noexcept {
+        return toNs(cycles());
+    }
+
+    static constexpr int64_t kCorrectionMs = 1000;
+
+private:
+    static constexpr int64_t kCalibrationMs = 10;
+    static constexpr int64_t kStepNs = 1000000;
+
+    struct Sample {
+        uint64_t cycles;
+        int64_t ns;
+    };
+
+    // Pair a counter reading with steady_clock, keeping the tightest of a few
+    // attempts so a preemption between the two reads does not skew the rate
+    static Sample sample() noexcept {
+        Sample best{0, 0};
+        int64_t bestGap = INT64_MAX;
+        for (int i = 0; i < 5; i++) {
+            int64_t before = steadyNs();
+            uint64_t c = cycles();
+            int64_t after = steadyNs();
+            if (after - before < bestGap) {
+                bestGap = after - before;
+                best = Sample{c, before + (after - before) / 2};
+            }
+        }
+        return best;
+    }
+
+    static double rateBetween(const Sample& a, const Sample& b) noexcept {
+        if (b.cycles <= a.cycles) return 1.0;
+        return static_cast<double>(b.ns - a.ns) / static_cast<double>(b.cycles - a.cycles);
+    }
+
+    int64_t toNs(uint64_t at) const noexcept {
+        uint32_t before;
+        int64_t ns;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            const uint64_t c0 = baseCycles.load(std::memory_order_relaxed);
+            const int64_t n0 = baseNs.load(std::memory_order_relaxed);
+            const double rate = nsPerCycle.load(std::memory_order_relaxed);
+            ns = n0 + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(at - c0)) * rate);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((before & 1) || before != seq.load(std::memory_order_relaxed));
+        return ns;
+    }
+
+    // Single writer: calibrate() before the clock is shared, then the ticker
+    void publish(uint64_t c0, int64_t n0, double rate) noexcept {
+        seq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        baseCycles.store(c0, std::memory_order_relaxed);
+        baseNs.store(n0, std::memory_order_relaxed);
+        nsPerCycle.store(rate, std::memory_order_relaxed);
+        seq.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> seq;
+    std::atomic<uint64_t> baseCycles;
+    std::atomic<int64_t> baseNs;
+    std::atomic<double> nsPerCycle;
+    Sample sync{0, 0};  // Last correction point, ticker thread only
+};
+
+class Clock {
+public:
+    explicit Clock(ClockSource source = ClockSource::Steady, int64_t tickMs = 1,
+                   ClockResolution resolution = ClockResolution::Milliseconds)
+        : source(source == ClockSource::Tsc && !TscClock::supported() ? ClockSource::Steady : source),
+          resolution(resolution),
+          cached(0),
+          stopping(false) {
+        if (this->source == ClockSource::Cached) {
+            cached.store(toTicks(TscClock::steadyNs()), std::memory_order_relaxed);
+            startTicker(std::chrono::milliseconds(tickMs > 0 ? tickMs : 1), [this] {
+                cached.store(toTicks(TscClock::steadyNs()), std::memory_order_relaxed);
+            });
+        } else if (this->source == ClockSource::Tsc) {
+            tsc.calibrate();
+            startTicker(std::chrono::milliseconds(TscClock::kCorrectionMs), [this] {
+                tsc.correct();
+            });
+        }
+        epochOffsetMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count() - now() / ticksPerMs();
+    }
+
+    ~Clock() {
+        {
+            std::lock_guard<std::mutex> lock(tickerMutex);
+            stopping = true;
+        }
+        tickerWake.notify_all();
+        if (ticker.joinable()) {
+            ticker.join();
+        }
+    }
+
+    Clock(const Clock&) = delete;
+    Clock& operator=(const Clock&) = delete;
+
+    // Current time in ticks of the configured resolution
+    int64_t now() const noexcept {
+        switch (source) {
+            case ClockSource::Cached:
+            case ClockSource::Manual:
+                return cached.load(std::memory_order_relaxed);
+            case ClockSource::Coarse:
+                return toTicks(coarseNs());
+            case ClockSource::Tsc:
+                return toTicks(tsc.nowNs());
+            default:
+                return toTicks(TscClock::steadyNs());
+        }
+    }
+
+    // Move a manual clock forward; returns false for any other source
+    bool advance(int64_t ticks) noexcept {
+        if (source != ClockSource::Manual) return false;
+        cached.fetch_add(ticks, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Source actually in use; Tsc falls back to Steady on unsupported CPUs
+    ClockSource getSource() const noexcept {
+        return source;
+    }
+
+    ClockResolution getResolution() const noexcept {
+        return resolution;
+    }
+
+    // Unix time in ms of a timestamp from now(). The offset to the wall
+    // clock is measured once, so later wall clock steps do not make
+    // timestamps jump; a manual clock starts at the time it was created.
+    int64_t toEpochMs(int64_t ticks) const noexcept {
+        return epochOffsetMs + ticks / ticksPerMs();
+    }
+
+    int64_t ticksPerMs() const noexcept {
+        switch (resolution) {
+            case ClockResolution::Nanoseconds: return 1000000;
+            case ClockResolution::Microseconds: return 1000;
+            default: return 1;
+        }
+    }
+
+    static int64_t coarseNs() noexcept {
+#ifdef CLOCK_MONOTONIC_COARSE
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+        return TscClock::steadyNs();
+#endif
+    }
+
+private:
+    // Constant divisors so the conversion compiles to a multiply
+    int64_t toTicks(int64_t ns) const noexcept {
+        switch (resolution) {
+            case ClockResolution::Nanoseconds: return ns;
+            case ClockResolution::Microseconds: return ns / 1000;
+            default: return ns / 1000000;
+        }
+    }
+
+    template <typename Fn>
+    void startTicker(std::chrono::milliseconds interval, Fn tick) {
+        ticker = std::thread([this, interval, tick] {
+            std::unique_lock<std::mutex> lock(tickerMutex);
+            while (!tickerWake.wait_for(lock, interval, [this] { return stopping; })) {
+                tick();
+            }
+        });
+    }
+
+    const ClockSource source;
+    const ClockResolution resolution;
+    std::atomic<int64_t> cached;  // Cached and Manual time, in ticks
+    int64_t epochOffsetMs = 0;    // Unix ms at tick zero
+    TscClock tsc;
+    std::mutex tickerMutex;
+    std::condition_variable tickerWake;
+    bool stopping;
+    std::thread ticker;
+};
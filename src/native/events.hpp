@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// State transitions a limiter reports to event subscribers
+enum class LimiterEvent : uint8_t {
+    Block,    // value: time the block ends, in clock ticks
+    Unblock,  // value: 0
+    Penalty   // value: penalty points after the change
+};
+
+// Bounded ring of limiter events. Any number of request threads push; one
+// consumer at a time drains. Cells carry a sequence number, so a push is one
+// CAS on the tail and a store of the cell, and neither side ever waits for
+// the other. When the ring is full new events are dropped and counted
+// rather than slowing down the decision that produced them.
+//
+// Events carry a copy of the key so they stay meaningful after the limiter
+// is removed; keys longer than kMaxKeyLength are truncated.
+class EventRing {
+public:
+    static constexpr size_t kMaxKeyLength = 102;
+
+    struct Event {
+        int64_t time;
+        int64_t value;
+        LimiterEvent type;
+        uint8_t keyLength;
+        char key[kMaxKeyLength];
+
+        std::string_view keyView() const noexcept {
+            return std::string_view(key, keyLength);
+        }
+    };
+
+    explicit EventRing(size_t capacity) {
+        size_t size = 64;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    size_t capacity() const noexcept {
+        return mask + 1;
+    }
+
+    bool push(LimiterEvent type, std::string_view key, int64_t time, int64_t value) noexcept {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[position & mask];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t lag = static_cast<int64_t>(sequence - position);
+            if (lag == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        Event& event = cell->event;
+        event.time = time;
+        event.value = value;
+        event.type = type;
+        event.keyLength = static_cast<uint8_t>(std::min(key.size(), kMaxKeyLength));
+        std::memcpy(event.key, key.data(), event.keyLength);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Move up to max published events into out; returns how many
+    size_t drain(std::vector<Event>& out, size_t max) {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        size_t count = 0;
+        while (count < max) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) break;
+            out.push_back(cell.event);
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            head++;
+            count++;
+        }
+        return count;
+    }
+
+    // Throw away whatever is published, e.g. what a previous subscriber of
+    // the ring left behind
+    void discard() noexcept {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        for (;;) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) break;
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            head++;
+        }
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+    // Events lost to a full ring since the last call
+    uint64_t takeDropped() noexcept {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> sequence;
+        Event event;
+    };
+    static_assert(sizeof(Cell) == 128, "an event cell is two cache lines");
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) std::atomic<uint64_t> dropped{0};
+    std::mutex consumerMutex;
+    uint64_t head = 0;  // Guarded by consumerMutex
+};
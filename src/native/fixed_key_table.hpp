@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+// Limiter tables keyed by fixed-width integers: IPv4 addresses (uint32_t),
+// user ids (uint64_t) or IPv6 addresses (Key128). Keys are stored inline and
+// compared as integers, and slots are picked with a multiply-shift hash, so a
+// lookup does no string work at all. Every key in a table shares one limit,
+// which leaves an entry with nothing but its bucket: 32 bytes for IPv4, 40 for
+// user ids and 48 for IPv6, against 256 for a keyed limiter.
+//
+// A key's bucket is created on its first request, and the table doubles
+// once it is half full. A full, unblocked bucket is in the state a new one
+// would start in, so those are dropped whenever the table is rebuilt, which
+// keeps tables of short-lived clients from growing forever.
+//
+// A table is not thread-safe. The binding hands each one to JavaScript as an
+// External, which cannot leave the isolate that made it, so every call comes
+// from that isolate's thread; that is why slots are plain fields and a
+// rebuild frees the old array at once.
+
+// IPv6 address as two big-endian halves
+struct Key128 {
+    uint64_t hi;
+    uint64_t lo;
+
+    bool operator==(const Key128& other) const noexcept {
+        return hi == other.hi && lo == other.lo;
+    }
+};
+
+// IPv4 addresses in an IPv6 table are stored IPv4-mapped (::ffff:a.b.c.d)
+inline Key128 mapIPv4(uint32_t address) noexcept {
+    return Key128{0, 0x0000ffff00000000ull | address};
+}
+
+inline bool parseIPv4(std::string_view text, uint32_t& address) noexcept {
+    uint32_t result = 0;
+    int parts = 0;
+    size_t i = 0;
+    while (parts < 4) {
+        size_t start = i;
+        uint32_t part = 0;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9' && i - start < 3) {
+            part = part * 10 + static_cast<uint32_t>(text[i] - '0');
+            i++;
+        }
+        // No empty parts, no leading zeros, nothing above 255
+        if (i == start || part > 255 || (text[start] == '0' && i - start > 1)) return false;
+        result = (result << 8) | part;
+        if (++parts < 4) {
+            if (i >= text.size() || text[i] != '.') return false;
+            i++;
+        }
+    }
+    if (i != text.size()) return false;
+    address = result;
+    return true;
+}
+
+// RFC 4291 text forms: '::' compression and a trailing dotted IPv4 part
+inline bool parseIPv6(std::string_view text, Key128& address) noexcept {
+    uint16_t groups[8] = {0};
+    int count = 0;
+    int gap = -1;  // Group index where '::' sits
+    size_t i = 0;
+
+    if (text.size() >= 2 && text[0] == ':' && text[1] == ':') {
+        gap = 0;
+        i = 2;
+    }
+    while (i < text.size()) {
+        if (count == 8) return false;
+
+        size_t start = i;
+        uint32_t group = 0;
+        while (i < text.size() && i - start < 4) {
+            char c = text[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = static_cast<uint32_t>(c - 'A' + 10);
+            else break;
+            group = (group << 4) | digit;
+            i++;
+        }
+
+        if (i < text.size() && text[i] == '.') {
+            // Embedded IPv4 takes the last two groups
+            uint32_t v4;
+            if (count > 6 || !parseIPv4(text.substr(start), v4)) return false;
+            groups[count++] = static_cast<uint16_t>(v4 >> 16);
+            groups[count++] = static_cast<uint16_t>(v4);
+            i = text.size();
+            break;
+        }
+        if (i == start) return false;
+        groups[count++] = static_cast<uint16_t>(group);
+
+        if (i == text.size()) break;
+        if (text[i] != ':') return false;
+        i++;
+        if (i < text.size() && text[i] == ':') {
+            if (gap >= 0) return false;
+            gap = count;
+            i++;
+        } else if (i == text.size()) {
+            return false;
+        }
+    }
+
+    if (gap >= 0) {
+        if (count == 8) return false;
+        int tail = count - gap;
+        for (int k = 0; k < tail; k++) {
+            groups[7 - k] = groups[count - 1 - k];
+            groups[count - 1 - k] = 0;
+        }
+    } else if (count != 8) {
+        return false;
+    }
+
+    address.hi = 0;
+    address.lo = 0;
+    for (int k = 0; k < 4; k++) address.hi = (address.hi << 16) | groups[k];
+    for (int k = 4; k < 8; k++) address.lo = (address.lo << 16) | groups[k];
+    return true;
+}
+
+template <typename Key>
+class FixedKeyTable {
+public:
+    using KeyType = Key;
+
+    // Durations in ticks of the owning limiter's clock
+    FixedKeyTable(int64_t maxTokens, int64_t refillTime, bool sliding, int64_t blockDuration,
+                  size_t capacity = 1024)
+        : maxTokens(maxTokens), refillTime(refillTime), sliding(sliding), blockDuration(blockDuration) {
+        if (maxTokens < 0) {
+            throw std::invalid_argument("maxTokens cannot be negative");
+        }
+        if (refillTime <= 0) {
+            throw std::invalid_argument("refillTime must be positive");
+        }
+        if (blockDuration < 0) {
+            throw std::invalid_argument("blockDuration cannot be negative");
+        }
+        current = allocate(std::max(size_t(64), capacity));
+    }
+
+    FixedKeyTable(const FixedKeyTable&) = delete;
+    FixedKeyTable& operator=(const FixedKeyTable&) = delete;
+
+    // now is the owning limiter's clock reading, so the table holds no
+    // reference to it and may outlive the limiter
+    bool tryRequest(const Key& key, int64_t now) {
+        Slot* slot = find(key);
+        if (!slot) slot = insert(key, now);
+
+        if (blockDuration > 0 && slot->blockUntil > now) {
+            return false;
+        }
+        refill(*slot, now);
+        if (slot->tokens > 0) {
+            slot->tokens--;
+            return true;
+        }
+        if (blockDuration > 0) {
+            slot->blockUntil = now + blockDuration;
+        }
+        return false;
+    }
+
+    // Tokens left for key; a key without a bucket has the full limit
+    int64_t getTokens(const Key& key, int64_t now) noexcept {
+        Slot* slot = find(key);
+        if (!slot) return maxTokens;
+        refill(*slot, now);
+        return std::max(int64_t(0), slot->tokens);
+    }
+
+    size_t size() const noexcept {
+        return count;
+    }
+
+private:
+    enum State : uint8_t {
+        kEmpty,
+        kLive
+    };
+
+    struct Slot {
+        int64_t tokens = 0;
+        int64_t lastRefill = 0;
+        int64_t blockUntil = 0;
+        Key key{};
+        uint8_t state = kEmpty;
+    };
+
+    const int64_t maxTokens;
+    const int64_t refillTime;
+    const bool sliding;
+    const int64_t blockDuration;
+
+    // Slot array together with its geometry
+    struct Buckets {
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        unsigned shift;
+    };
+
+    std::unique_ptr<Buckets> current;
+    size_t count = 0;
+
+    static uint64_t mix(uint32_t key) noexcept {
+        return static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ull;
+    }
+
+    static uint64_t mix(uint64_t key) noexcept {
+        return (key ^ (key >> 32)) * 0x9e3779b97f4a7c15ull;
+    }
+
+    static uint64_t mix(const Key128& key) noexcept {
+        return (key.hi * 0xc2b2ae3d27d4eb4full) ^ ((key.lo ^ (key.lo >> 32)) * 0x9e3779b97f4a7c15ull);
+    }
+
+    // Multiply-shift: the high bits of the product are the best mixed
+    static size_t home(const Buckets& buckets, const Key& key) noexcept {
+        return static_cast<size_t>(mix(key) >> buckets.shift);
+    }
+
+    static std::unique_ptr<Buckets> allocate(size_t capacity) {
+        size_t size = 64;
+        unsigned bits = 6;
+        while (size < capacity) {
+            size <<= 1;
+            bits++;
+        }
+        return std::unique_ptr<Buckets>(new Buckets{std::unique_ptr<Slot[]>(new Slot[size]), size - 1, 64 - bits});
+    }
+
+    Slot* find(const Key& key) noexcept {
+        const Buckets& buckets = *current;
+        Slot* table = buckets.slots.get();
+        const size_t m = buckets.mask;
+        for (size_t idx = home(buckets, key), probes = 0; probes <= m; idx = (idx + 1) & m, probes++) {
+            if (table[idx].state == kEmpty) return nullptr;
+            if (table[idx].key == key) return &table[idx];
+        }
+        return nullptr;
+    }
+
+    // Linear probe to the first free slot
+    static Slot& claim(const Buckets& buckets, const Key& key) noexcept {
+        size_t idx = home(buckets, key);
+        while (buckets.slots[idx].state != kEmpty) {
+            idx = (idx + 1) & buckets.mask;
+        }
+        return buckets.slots[idx];
+    }
+
+    Slot* insert(const Key& key, int64_t now) {
+        if ((count + 1) * 2 > current->mask + 1) {
+            rebuild(now);
+        }
+
+        Slot& slot = claim(*current, key);
+        slot.key = key;
+        slot.tokens = maxTokens;
+        slot.lastRefill = now;
+        slot.blockUntil = 0;
+        slot.state = kLive;
+        count++;
+        return &slot;
+    }
+
+    // Copy the buckets that differ from a new one into a table sized for
+    // them, doubling only if dropping the rest did not free enough room
+    void rebuild(int64_t now) {
+        Slot* old = current->slots.get();
+        const size_t oldSize = current->mask + 1;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < oldSize; i++) {
+            if (old[i].state == kLive && !reclaimable(old[i], now)) kept++;
+        }
+        std::unique_ptr<Buckets> next = allocate((kept + 1) * 4 > oldSize ? oldSize * 2 : oldSize);
+
+        for (size_t i = 0; i < oldSize; i++) {
+            Slot& from = old[i];
+            if (from.state != kLive || reclaimable(from, now)) continue;
+            claim(*next, from.key) = from;
+        }
+        count = kept;
+        current = std::move(next);
+    }
+
+    bool reclaimable(Slot& slot, int64_t now) const noexcept {
+        if (slot.blockUntil > now) return false;
+        refill(slot, now);
+        return slot.tokens >= maxTokens;
+    }
+
+    // The fixed-window and sliding arithmetic of RateLimiter::refillTokens,
+    // for a bucket without penalties
+    void refill(Slot& slot, int64_t now) const noexcept {
+        const int64_t timePassed = now - slot.lastRefill;
+
+        if (!sliding) {
+            if (timePassed >= refillTime) {
+                slot.lastRefill = now;
+                slot.tokens = maxTokens;
+            }
+            return;
+        }
+
+        int64_t elapsed = 0;
+        if (slot.tokens < maxTokens) {
+            int64_t timeToFull = ((maxTokens - slot.tokens) * refillTime + maxTokens - 1) / maxTokens;
+            elapsed = std::min(timePassed, timeToFull);
+        }
+        const int64_t tokensToAdd = (maxTokens * elapsed) / refillTime;
+        if (tokensToAdd <= 0 && slot.tokens < maxTokens) return;
+
+        if (slot.tokens + tokensToAdd < maxTokens) {
+            slot.lastRefill += (tokensToAdd * refillTime + maxTokens - 1) / maxTokens;
+        } else {
+            slot.lastRefill = now;
+        }
+        slot.tokens = std::min(slot.tokens + tokensToAdd, maxTokens);
+    }
+};
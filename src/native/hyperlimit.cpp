@@ -1,8 +1,354 @@
 #include <napi.h>
+#include <cstdio>
+#include <deque>
+#include <unordered_set>
+#include <functional>
+#include <variant>
 #include "ratelimiter.hpp"
+#include "fixed_key_table.hpp"
+#include "shm_table.hpp"
+#include "rules.hpp"
 #include "redis_storage.hpp"
 #include "nats_storage.hpp"
 
+// Strings that did not fit a StringArg's inline buffer; reported by getStats
+static std::atomic<uint64_t> heapStringCopies{0};
+
+// A JS string argument read without allocating. The UTF-8 length is queried
+// first and strings that fit are copied into a buffer on the caller's stack;
+// only longer ones fall back to the heap. Anything but a string reads as
+// empty. The view is valid for the lifetime of the StringArg.
+class StringArg {
+public:
+    explicit StringArg(const Napi::Value& value) {
+        if (!value.IsString()) return;
+        napi_env env = value.Env();
+        size_t length = 0;
+        napi_get_value_string_utf8(env, value, nullptr, 0, &length);
+        char* target = inlineBuffer;
+        if (length >= sizeof(inlineBuffer)) {
+            heapBuffer.resize(length + 1);
+            target = &heapBuffer[0];
+            heapStringCopies.fetch_add(1, std::memory_order_relaxed);
+        }
+        napi_get_value_string_utf8(env, value, target, length + 1, &length);
+        view = std::string_view(target, length);
+    }
+
+    StringArg(const StringArg&) = delete;
+    StringArg& operator=(const StringArg&) = delete;
+
+    operator std::string_view() const noexcept {
+        return view;
+    }
+
+private:
+    char inlineBuffer[256];
+    std::string heapBuffer;
+    std::string_view view{};
+};
+
+// Externals handed to JS are type-tagged by kind. An External of another
+// kind, or one made by another addon, is rejected instead of being cast to
+// the wrong type.
+static const napi_type_tag kHandleTag = {0x6879706572686e64ull, 0x9f3c2a71d54e8b06ull};
+static const napi_type_tag kKeyTableTag = {0x68797065726b7462ull, 0x2b71e0c94d3a8f57ull};
+static const napi_type_tag kSharedTableTag = {0x6879706572736874ull, 0xc85d13a6f0e97b24ull};
+
+template <typename T>
+static Napi::External<T> tagExternal(Napi::External<T> external, const napi_type_tag& tag) {
+    napi_type_tag_object(external.Env(), external, &tag);
+    return external;
+}
+
+// The T behind value, or null unless value is an External tagged as tag
+template <typename T>
+static T* taggedExternal(const Napi::Value& value, const napi_type_tag& tag) {
+    if (!value.IsExternal()) return nullptr;
+    bool matches = false;
+    if (napi_check_object_type_tag(value.Env(), value, &tag, &matches) != napi_ok || !matches) return nullptr;
+    return value.As<Napi::External<T>>().Data();
+}
+
+// Limiters made available to other threads by share(), by token. The addon
+// is loaded once per process, so every worker_thread sees this registry.
+// Entries are weak: a limiter lives as long as some instance uses it.
+static std::mutex sharedLimitersMutex;
+static std::unordered_map<uint32_t, std::weak_ptr<RateLimiter>> sharedLimiters;
+static uint32_t nextShareToken = 1;
+
+// Native limiter shared by an instance and the functions bound to it, so a
+// bound function that outlives its instance finds no limiter instead of a
+// dangling one
+struct BoundLimiter {
+    RateLimiter* limiter;
+};
+
+// Runs limiter calls that wait on Redis or NATS on threads of its own, one
+// per storage connection, and settles their Promises on the JS thread
+// through a ThreadSafeFunction. Each call leases a pooled connection for its
+// round trips, so as many run at once as there are connections, and none
+// takes a libuv pool thread from file or DNS work. A call holds its own
+// reference to the limiter and to the JS instance, so neither goes away
+// while it runs.
+class StorageQueue {
+public:
+    StorageQueue(Napi::Env env, size_t threads) {
+        // Settling calls no JS function, so the one given is a placeholder
+        settleJs = Napi::ThreadSafeFunction::New(env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}),
+                                                 "hyperlimit storage", 0, 1);
+        settleJs.Unref(env);
+        for (size_t i = 0; i < std::max(size_t(1), threads); i++) {
+            workers.emplace_back([this] { serve(); });
+        }
+    }
+
+    ~StorageQueue() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueWake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+        // Calls never started belong to an environment that is going away;
+        // their Promises can no longer be settled
+        for (Call* call : queue) Call::abandon(call);
+        settleJs.Release();
+    }
+
+    StorageQueue(const StorageQueue&) = delete;
+    StorageQueue& operator=(const StorageQueue&) = delete;
+
+    // A Promise settled with settle(work()), or rejected with what work threw
+    template <typename Result>
+    Napi::Promise run(Napi::Env env, Napi::Object owner, std::function<Result()> work,
+                      std::function<Napi::Value(Napi::Env, const Result&)> settle) {
+        auto call = new TypedCall<Result>(env, owner, std::move(work), std::move(settle));
+        Napi::Promise promise = call->deferred.Promise();
+        // Pending calls keep the process alive, as queued libuv work would
+        if (pending++ == 0) settleJs.Ref(env);
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queue.push_back(call);
+        }
+        queueWake.notify_one();
+        return promise;
+    }
+
+private:
+    struct Call {
+        Call(Napi::Env env, Napi::Object owner)
+            : deferred(Napi::Promise::Deferred::New(env)), owner(Napi::Persistent(owner)) {}
+        virtual ~Call() = default;
+
+        virtual void execute() = 0;
+        virtual Napi::Value result(Napi::Env env) = 0;
+
+        // Free a call without touching the environment its handles belong to
+        static void abandon(Call* call) noexcept {
+            call->owner.SuppressDestruct();
+            delete call;
+        }
+
+        Napi::Promise::Deferred deferred;
+        Napi::ObjectReference owner;
+        std::string error;
+        bool failed = false;
+        StorageQueue* queue = nullptr;
+    };
+
+    template <typename Result>
+    struct TypedCall : Call {
+        TypedCall(Napi::Env env, Napi::Object owner, std::function<Result()> work,
+                  std::function<Napi::Value(Napi::Env, const Result&)> settle)
+            : Call(env, owner), work(std::move(work)), settle(std::move(settle)) {}
+
+        void execute() override {
+            value = work();
+        }
+
+        Napi::Value result(Napi::Env env) override {
+            return settle(env, value);
+        }
+
+        std::function<Result()> work;
+        std::function<Napi::Value(Napi::Env, const Result&)> settle;
+        Result value{};
+    };
+
+    void serve() {
+        for (;;) {
+            Call* call;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueWake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                call = queue.front();
+                queue.pop_front();
+            }
+            try {
+                call->execute();
+            } catch (const std::exception& e) {
+                call->failed = true;
+                call->error = e.what();
+            }
+            call->queue = this;
+            if (settleJs.NonBlockingCall(call, deliver) != napi_ok) Call::abandon(call);
+        }
+    }
+
+    // Runs on the JS thread
+    static void deliver(Napi::Env env, Napi::Function, Call* data) {
+        if (env == nullptr) {
+            Call::abandon(data);
+            return;
+        }
+        std::unique_ptr<Call> call(data);
+        if (--call->queue->pending == 0) call->queue->settleJs.Unref(env);
+        if (call->failed) {
+            call->deferred.Reject(Napi::Error::New(env, call->error).Value());
+        } else {
+            call->deferred.Resolve(call->result(env));
+        }
+    }
+
+    Napi::ThreadSafeFunction settleJs;
+    std::vector<std::thread> workers;
+    std::deque<Call*> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueWake;
+    bool stopping = false;
+    size_t pending = 0;  // JS thread only
+};
+
+// Delivers a limiter's events to a JS callback. A thread drains the event
+// ring every interval and hands what it found to a ThreadSafeFunction as one
+// batch, so JS is called at most once per interval however busy the limiter
+// is. The function is unreferenced and does not keep the process alive.
+class EventPump {
+public:
+    EventPump(Napi::Env env, Napi::Function callback, std::shared_ptr<RateLimiter> limiter,
+              int64_t intervalMs, size_t capacity)
+        : limiter(limiter),
+          slot(limiter->subscribeEvents(capacity)),
+          ring(limiter->eventRing(slot)),
+          ticksPerMs(static_cast<double>(limiter->getClock().ticksPerMs())) {
+        callJs = Napi::ThreadSafeFunction::New(env, callback, "hyperlimit events", 0, 1);
+        callJs.Unref(env);
+        pump = std::thread([this, intervalMs] {
+            std::unique_lock<std::mutex> lock(pumpMutex);
+            while (!pumpWake.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return stopping; })) {
+                flush();
+            }
+        });
+    }
+
+    ~EventPump() {
+        {
+            std::lock_guard<std::mutex> lock(pumpMutex);
+            stopping = true;
+        }
+        pumpWake.notify_all();
+        pump.join();
+        limiter->unsubscribeEvents(slot);
+        flush();
+        callJs.Release();
+    }
+
+    EventPump(const EventPump&) = delete;
+    EventPump& operator=(const EventPump&) = delete;
+
+private:
+    struct Batch {
+        std::vector<EventRing::Event> events;
+        uint64_t dropped;
+        double ticksPerMs;
+    };
+
+    void flush() {
+        auto batch = std::make_unique<Batch>();
+        ring.drain(batch->events, ring.capacity());
+        batch->dropped = ring.takeDropped();
+        batch->ticksPerMs = ticksPerMs;
+        if (batch->events.empty() && batch->dropped == 0) return;
+        if (callJs.NonBlockingCall(batch.get(), deliver) == napi_ok) batch.release();
+    }
+
+    // Runs on the JS thread: callback(events, dropped)
+    static void deliver(Napi::Env env, Napi::Function callback, Batch* data) {
+        std::unique_ptr<Batch> batch(data);
+        if (env == nullptr) return;
+
+        Napi::Array events = Napi::Array::New(env, batch->events.size());
+        for (size_t i = 0; i < batch->events.size(); i++) {
+            const EventRing::Event& event = batch->events[i];
+            Napi::Object item = Napi::Object::New(env);
+            std::string_view key = event.keyView();
+            item.Set("key", Napi::String::New(env, key.data(), key.size()));
+            item.Set("time", Napi::Number::New(env, event.time / batch->ticksPerMs));
+            switch (event.type) {
+                case LimiterEvent::Block:
+                    item.Set("type", Napi::String::New(env, "block"));
+                    item.Set("until", Napi::Number::New(env, event.value / batch->ticksPerMs));
+                    break;
+                case LimiterEvent::Unblock:
+                    item.Set("type", Napi::String::New(env, "unblock"));
+                    break;
+                case LimiterEvent::Penalty:
+                    item.Set("type", Napi::String::New(env, "penalty"));
+                    item.Set("points", Napi::Number::New(env, static_cast<double>(event.value)));
+                    break;
+            }
+            events.Set(static_cast<uint32_t>(i), item);
+        }
+        callback.Call({events, Napi::Number::New(env, static_cast<double>(batch->dropped))});
+    }
+
+    std::shared_ptr<RateLimiter> limiter;
+    const size_t slot;
+    EventRing& ring;
+    const double ticksPerMs;
+    Napi::ThreadSafeFunction callJs;
+    std::thread pump;
+    std::mutex pumpMutex;
+    std::condition_variable pumpWake;
+    bool stopping = false;
+};
+
+// Header strings made by decide(), kept as JS strings and handed out again
+// while the values they render are unchanged. A hot limiter, and a flood of
+// rejections in particular, renders the same few values over and over, so
+// each is formatted and converted once. Direct-mapped on the values; a slot
+// keeps both, so distinct pairs never share a string.
+class HeaderCache {
+public:
+    template <typename Format>
+    Napi::Value get(Napi::Env env, int64_t first, int64_t second, Format&& format) {
+        const uint64_t hash = (static_cast<uint64_t>(first) * 0x9e3779b97f4a7c15ull) ^
+                              (static_cast<uint64_t>(second) * 0xc2b2ae3d27d4eb4full);
+        Slot& slot = slots[(hash * 0x9e3779b97f4a7c15ull) >> (64 - kSlotBits)];
+        if (slot.first == first && slot.second == second && !slot.text.IsEmpty()) {
+            return slot.text.Value();
+        }
+        char buffer[96];
+        int length = format(buffer, sizeof(buffer));
+        Napi::String text = Napi::String::New(env, buffer, static_cast<size_t>(length));
+        slot.first = first;
+        slot.second = second;
+        slot.text = Napi::Persistent(text);
+        return text;
+    }
+
+private:
+    static constexpr unsigned kSlotBits = 8;
+    struct Slot {
+        int64_t first = 0;
+        int64_t second = 0;
+        Napi::Reference<Napi::String> text;
+    };
+    std::array<Slot, size_t(1) << kSlotBits> slots;
+};
+
 class HyperLimit : public Napi::ObjectWrap<HyperLimit> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports) {
@@ -10,9 +356,32 @@ public:
             InstanceMethod("createLimiter", &HyperLimit::CreateLimiter),
             InstanceMethod("removeLimiter", &HyperLimit::RemoveLimiter),
             InstanceMethod("tryRequest", &HyperLimit::TryRequest),
+            InstanceMethod("tryRequestAsync", &HyperLimit::TryRequestAsync),
+            InstanceMethod("tryRequestById", &HyperLimit::TryRequestById),
+            InstanceMethod("tryRequestBatch", &HyperLimit::TryRequestBatch),
+            InstanceMethod("tryRequestInfo", &HyperLimit::TryRequestInfo),
+            InstanceMethod("configureDecide", &HyperLimit::ConfigureDecide),
+            InstanceMethod("decide", &HyperLimit::Decide),
+            InstanceMethod("createHandle", &HyperLimit::CreateHandle),
+            InstanceMethod("consume", &HyperLimit::Consume),
+            InstanceMethod("createKeyTable", &HyperLimit::CreateKeyTable),
+            InstanceMethod("tryRequestKey", &HyperLimit::TryRequestKey),
+            InstanceMethod("getKeyTokens", &HyperLimit::GetKeyTokens),
+            InstanceMethod("setStriping", &HyperLimit::SetStriping),
+            InstanceMethod("loadRules", &HyperLimit::LoadRules),
+            InstanceMethod("matchRule", &HyperLimit::MatchRule),
+            InstanceMethod("createBandwidthLimiter", &HyperLimit::CreateBandwidthLimiter),
+            InstanceMethod("ensureBandwidthLimiter", &HyperLimit::EnsureBandwidthLimiter),
+            InstanceMethod("consumeBytes", &HyperLimit::ConsumeBytes),
+            InstanceMethod("charge", &HyperLimit::Charge),
+            InstanceMethod("chargeAsync", &HyperLimit::ChargeAsync),
             InstanceMethod("getTokens", &HyperLimit::GetTokens),
             InstanceMethod("getCurrentLimit", &HyperLimit::GetCurrentLimit),
             InstanceMethod("getRateLimitInfo", &HyperLimit::GetRateLimitInfo),
+            InstanceMethod("getRateLimitInfoAsync", &HyperLimit::GetRateLimitInfoAsync),
+            InstanceMethod("getInfoMany", &HyperLimit::GetInfoMany),
+            InstanceMethod("getTokensById", &HyperLimit::GetTokensById),
+            InstanceMethod("getInfoById", &HyperLimit::GetInfoById),
             InstanceMethod("addPenalty", &HyperLimit::AddPenalty),
             InstanceMethod("removePenalty", &HyperLimit::RemovePenalty),
             InstanceMethod("addToWhitelist", &HyperLimit::AddToWhitelist),
@@ -21,8 +390,27 @@ public:
             InstanceMethod("removeFromBlacklist", &HyperLimit::RemoveFromBlacklist),
             InstanceMethod("isWhitelisted", &HyperLimit::IsWhitelisted),
             InstanceMethod("isBlacklisted", &HyperLimit::IsBlacklisted),
+            InstanceMethod("setTenantWeight", &HyperLimit::SetTenantWeight),
+            InstanceMethod("tryRequestFairShare", &HyperLimit::TryRequestFairShare),
+            InstanceMethod("getFairShareInfo", &HyperLimit::GetFairShareInfo),
+            InstanceMethod("now", &HyperLimit::Now),
+            InstanceMethod("advanceTime", &HyperLimit::AdvanceTime),
+            InstanceMethod("getClock", &HyperLimit::GetClock),
+            InstanceMethod("runMaintenance", &HyperLimit::RunMaintenance),
+            InstanceMethod("onEvents", &HyperLimit::OnEvents),
+            InstanceMethod("offEvents", &HyperLimit::OffEvents),
             InstanceMethod("getStats", &HyperLimit::GetStats),
+            InstanceMethod("getTableStats", &HyperLimit::GetTableStats),
             InstanceMethod("resetStats", &HyperLimit::ResetStats),
+            InstanceMethod("share", &HyperLimit::Share),
+            InstanceMethod("openSharedTable", &HyperLimit::OpenSharedTable),
+            InstanceMethod("createSharedLimiter", &HyperLimit::CreateSharedLimiter),
+            InstanceMethod("removeSharedLimiter", &HyperLimit::RemoveSharedLimiter),
+            InstanceMethod("tryRequestShared", &HyperLimit::TryRequestShared),
+            InstanceMethod("getSharedTokens", &HyperLimit::GetSharedTokens),
+            InstanceMethod("getSharedStats", &HyperLimit::GetSharedStats),
+            StaticMethod("parseIp", &HyperLimit::ParseIp),
+            StaticMethod("unlinkSharedTable", &HyperLimit::UnlinkSharedTable),
         });
 
         Napi::FunctionReference* constructor = new Napi::FunctionReference();
@@ -36,10 +424,34 @@ public:
     HyperLimit(const Napi::CallbackInfo& info) : Napi::ObjectWrap<HyperLimit>(info) {
         Napi::Env env = info.Env();
         size_t bucketCount = 16384; // Default value
-        std::unique_ptr<DistributedStorage> storage;
+        StoragePool::Connections storage;
+        ClockSource clockSource = ClockSource::Steady;
+        int64_t clockTickMs = 1;
+        ClockResolution resolution = ClockResolution::Milliseconds;
+        std::shared_ptr<RateLimiter> attached;
 
         if (info.Length() > 0 && info[0].IsObject()) {
             Napi::Object options = info[0].As<Napi::Object>();
+
+            // Token from share() on another thread: attach to that limiter.
+            // Its table, clock, storage and maintenance are already set up,
+            // so the options configuring those are ignored.
+            if (options.Has("shared")) {
+                Napi::Value val = options.Get("shared");
+                if (val.IsNumber()) {
+                    std::lock_guard<std::mutex> lock(sharedLimitersMutex);
+                    auto it = sharedLimiters.find(val.As<Napi::Number>().Uint32Value());
+                    if (it != sharedLimiters.end()) {
+                        attached = it->second.lock();
+                        shareToken = it->first;
+                    }
+                }
+                if (!attached) {
+                    Napi::Error::New(env, "shared must be a token from share() of a limiter still in use")
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
             
             // Get bucket count if specified
             if (options.Has("bucketCount")) {
@@ -54,8 +466,77 @@ public:
                 }
             }
 
+            // Clock source: 'steady' (default), 'coarse', 'cached', 'tsc' or 'manual'
+            if (options.Has("clock")) {
+                Napi::Value val = options.Get("clock");
+                std::string name = val.IsString() ? val.As<Napi::String>().Utf8Value() : "";
+                if (name == "steady") {
+                    clockSource = ClockSource::Steady;
+                } else if (name == "coarse") {
+                    clockSource = ClockSource::Coarse;
+                } else if (name == "cached") {
+                    clockSource = ClockSource::Cached;
+                } else if (name == "tsc") {
+                    clockSource = ClockSource::Tsc;
+                } else if (name == "manual") {
+                    clockSource = ClockSource::Manual;
+                } else {
+                    Napi::Error::New(env, "clock must be 'steady', 'coarse', 'cached', 'tsc' or 'manual'")
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+            // Time unit used internally: 'ms' (default), 'us' or 'ns'. Durations
+            // are still given in (possibly fractional) milliseconds.
+            if (options.Has("resolution")) {
+                Napi::Value val = options.Get("resolution");
+                std::string name = val.IsString() ? val.As<Napi::String>().Utf8Value() : "";
+                if (name == "ms") {
+                    resolution = ClockResolution::Milliseconds;
+                } else if (name == "us") {
+                    resolution = ClockResolution::Microseconds;
+                } else if (name == "ns") {
+                    resolution = ClockResolution::Nanoseconds;
+                } else {
+                    Napi::Error::New(env, "resolution must be 'ms', 'us' or 'ns'")
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+            // Array tryRequestInfo writes its results to: a Float64Array or
+            // BigInt64Array of at least kInfoFields elements, kept alive and
+            // written in place so no result object is allocated per request
+            if (options.Has("infoArray")) {
+                Napi::Value val = options.Get("infoArray");
+                napi_typedarray_type type = val.IsTypedArray() ?
+                    val.As<Napi::TypedArray>().TypedArrayType() : napi_int8_array;
+                if ((type != napi_float64_array && type != napi_bigint64_array) ||
+                    val.As<Napi::TypedArray>().ElementLength() < kInfoFields) {
+                    Napi::TypeError::New(env, "infoArray must be a Float64Array or BigInt64Array of at least 5 elements")
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+                Napi::TypedArray array = val.As<Napi::TypedArray>();
+                void* data = static_cast<uint8_t*>(array.ArrayBuffer().Data()) + array.ByteOffset();
+                if (type == napi_float64_array) {
+                    infoDoubles = static_cast<double*>(data);
+                } else {
+                    infoInts = static_cast<int64_t*>(data);
+                }
+                infoLength = array.ElementLength();
+                infoArray = Napi::Persistent(array);
+            }
+            if (options.Has("clockTickMs") && options.Get("clockTickMs").IsNumber()) {
+                clockTickMs = options.Get("clockTickMs").As<Napi::Number>().Int64Value();
+                if (clockTickMs < 1) {
+                    Napi::Error::New(env, "clockTickMs must be at least 1")
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+
             // Check for Redis options
-            if (options.Has("redis") && options.Get("redis").IsObject()) {
+            if (!attached && options.Has("redis") && options.Get("redis").IsObject()) {
                 Napi::Object redisOpts = options.Get("redis").As<Napi::Object>();
                 std::string host = "localhost";
                 int port = 6379;
@@ -72,7 +553,10 @@ public:
                 }
 
                 try {
-                    storage = std::make_unique<RedisStorage>(host, port, prefix);
+                    storage.clear();
+                    for (size_t i = ConnectionCount(redisOpts); i > 0; i--) {
+                        storage.push_back(std::make_unique<RedisStorage>(host, port, prefix));
+                    }
                 } catch (const std::exception& e) {
                     Napi::Error::New(env, std::string("Redis connection failed: ") + e.what())
                         .ThrowAsJavaScriptException();
@@ -81,7 +565,7 @@ public:
             }
 
             // Check for NATS options
-            if (options.Has("nats") && options.Get("nats").IsObject()) {
+            if (!attached && options.Has("nats") && options.Get("nats").IsObject()) {
                 Napi::Object natsOpts = options.Get("nats").As<Napi::Object>();
                 std::string servers = "nats://localhost:4222";
                 std::string bucket = "rate-limits";
@@ -112,50 +596,1215 @@ public:
                     credentials = &creds;
                 }
 
-                try {
-                    storage = std::make_unique<NatsStorage>(servers, bucket, prefix, credentials);
-                } catch (const std::exception& e) {
-                    Napi::Error::New(env, std::string("NATS connection failed: ") + e.what())
-                        .ThrowAsJavaScriptException();
-                    return;
+                try {
+                    storage.clear();
+                    for (size_t i = ConnectionCount(natsOpts); i > 0; i--) {
+                        storage.push_back(std::make_unique<NatsStorage>(servers, bucket, prefix, credentials));
+                    }
+                } catch (const std::exception& e) {
+                    Napi::Error::New(env, std::string("NATS connection failed: ") + e.what())
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+        }
+
+        try {
+            if (attached) {
+                rateLimiter = std::move(attached);
+                BindHotMethods(env, info.This());
+                return;
+            }
+            rateLimiter = std::make_shared<RateLimiter>(bucketCount, std::move(storage), clockSource,
+                                                        clockTickMs, resolution);
+            BindHotMethods(env, info.This());
+
+            // Background sweep: { interval (ms, default 100), batch (slots per
+            // tick, default 1024), idleTimeout (ms, 0 keeps idle limiters) }
+            if (info.Length() > 0 && info[0].IsObject() &&
+                info[0].As<Napi::Object>().Get("maintenance").IsObject()) {
+                Napi::Object maintenance = info[0].As<Napi::Object>().Get("maintenance").As<Napi::Object>();
+                int64_t interval = maintenance.Get("interval").IsNumber() ?
+                    maintenance.Get("interval").As<Napi::Number>().Int64Value() : 100;
+                int64_t batch = maintenance.Get("batch").IsNumber() ?
+                    maintenance.Get("batch").As<Napi::Number>().Int64Value() : 1024;
+                int64_t idleTimeout = maintenance.Get("idleTimeout").IsNumber() ?
+                    toTicks(maintenance.Get("idleTimeout")) : 0;
+                rateLimiter->startMaintenance(interval, static_cast<size_t>(std::max(int64_t(0), batch)),
+                                              idleTimeout);
+            }
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+
+    ~HyperLimit() {
+        if (bound) bound->limiter = nullptr;
+        eventPump.reset();
+        storageQueue.reset();
+    }
+
+private:
+    std::shared_ptr<RateLimiter> rateLimiter;
+    uint32_t shareToken = 0;  // Registry token once shared, 0 before
+    std::shared_ptr<BoundLimiter> bound;
+    std::unique_ptr<RuleSet> rules;
+    std::vector<std::string> headerBuffer;  // Reused across matchRule calls
+    std::unique_ptr<EventPump> eventPump;
+    std::unique_ptr<StorageQueue> storageQueue;  // Started by the first storage call
+
+    // Storage connections to open: the connections option, 4 by default.
+    // Each lets one more storage call run while others wait on the network.
+    static size_t ConnectionCount(const Napi::Object& options) {
+        if (!options.Get("connections").IsNumber()) return 4;
+        return static_cast<size_t>(std::clamp<int64_t>(
+            options.Get("connections").As<Napi::Number>().Int64Value(), 1, 64));
+    }
+
+    StorageQueue& Storage(Napi::Env env) {
+        if (!storageQueue) {
+            storageQueue = std::make_unique<StorageQueue>(env, rateLimiter->storageConnections());
+        }
+        return *storageQueue;
+    }
+
+    // tryRequestInfo output: allowed, limit, remaining, reset (ms on the
+    // limiter's clock) and retryAfter (seconds), then resetAt (Unix ms) if
+    // the array has room for it
+    static constexpr size_t kInfoFields = 5;
+    // getInfoMany: limit, remaining, reset, blocked, retryAfter per key, then
+    // resetAt if the output has room for it
+    static constexpr size_t kInfoManyFields = 5;
+    // getStats(into): the getStats() numbers in declaration order
+    static constexpr size_t kStatsFields = 8;
+    Napi::Reference<Napi::TypedArray> infoArray;
+    size_t infoLength = 0;
+    double* infoDoubles = nullptr;
+    int64_t* infoInts = nullptr;
+
+    // decide(): bypass tokens, viewed from bypassStorage, and the settings
+    // of limiters it creates on first use
+    std::vector<std::string> bypassStorage;
+    std::unordered_set<std::string_view> bypassKeys;
+    std::unique_ptr<RuleLimit> decideDefaults;
+    // Header values decide() writes for the middleware, in HeaderSlot order,
+    // and the cached strings they are made from
+    enum HeaderSlot { kLimitHeader, kRemainingHeader, kResetHeader, kPolicyHeader, kRateLimitHeader };
+    Napi::Reference<Napi::Array> headerValues;
+    bool legacyHeaders = false;
+    bool standardHeaders = false;
+    HeaderCache numberStrings;
+    HeaderCache policyStrings;
+    HeaderCache rateLimitStrings;
+
+    // Durations cross the boundary in milliseconds, fractional ones included,
+    // and are kept in clock ticks natively
+    int64_t toTicks(const Napi::Value& ms) const {
+        double value = ms.As<Napi::Number>().DoubleValue();
+        if (!std::isfinite(value)) return 0;
+        return static_cast<int64_t>(value * rateLimiter->getClock().ticksPerMs());
+    }
+
+    double toMs(int64_t ticks) const noexcept {
+        return static_cast<double>(ticks) / rateLimiter->getClock().ticksPerMs();
+    }
+
+    // Unix time in ms of a reset on the limiter's clock; 0 for unknown keys,
+    // which report a reset of 0
+    double resetAt(int64_t reset) const noexcept {
+        return reset > 0 ? static_cast<double>(rateLimiter->getClock().toEpochMs(reset)) : 0;
+    }
+
+    Napi::Value CreateLimiter(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 3) {
+            Napi::TypeError::New(env, "Wrong number of arguments")
+                .ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string key = info[0].As<Napi::String>().Utf8Value();
+        int64_t maxTokens = info[1].As<Napi::Number>().Int64Value();
+        int64_t refillTime = toTicks(info[2]);
+        bool useSlidingWindow = info.Length() > 3 && info[3].IsBoolean() ? info[3].As<Napi::Boolean>().Value() : false;
+        int64_t blockDuration = info.Length() > 4 && info[4].IsNumber() ? toTicks(info[4]) : 0;
+        int64_t maxPenaltyPoints = info.Length() > 5 && info[5].IsNumber() ? info[5].As<Napi::Number>().Int64Value() : 0;
+        std::string distributedKey = info.Length() > 6 && info[6].IsString() ? info[6].As<Napi::String>().Utf8Value() : "";
+        bool withId = info.Length() > 7 && info[7].IsBoolean() && info[7].As<Napi::Boolean>().Value();
+
+        try {
+            uint32_t id = rateLimiter->createLimiter(key, maxTokens, refillTime, useSlidingWindow,
+                                                     blockDuration, maxPenaltyPoints, distributedKey, withId);
+            if (withId) {
+                return Napi::Number::New(env, id);
+            }
+            return Napi::Boolean::New(env, true);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value RemoveLimiter(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string key = info[0].As<Napi::String>().Utf8Value();
+
+        try {
+            rateLimiter->removeLimiter(key);
+            return Napi::Boolean::New(env, true);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // tryRequest and tryRequestById run once per request, and as prototype
+    // methods every call would build a CallbackInfo and look the native
+    // object up with napi_unwrap. Each instance instead gets its own
+    // non-enumerable copies of the two, created on plain N-API with the
+    // limiter as callback data: a call reads its arguments into a stack
+    // array and goes straight to the limiter. The prototype methods remain
+    // for calls with another receiver.
+    void BindHotMethods(Napi::Env env, napi_value self) {
+        bound = std::make_shared<BoundLimiter>(BoundLimiter{rateLimiter.get()});
+        napi_property_descriptor methods[] = {
+            {"tryRequest", nullptr, BoundTryRequest, nullptr, nullptr, nullptr,
+             static_cast<napi_property_attributes>(napi_writable | napi_configurable), nullptr},
+            {"tryRequestById", nullptr, BoundTryRequestById, nullptr, nullptr, nullptr,
+             static_cast<napi_property_attributes>(napi_writable | napi_configurable), nullptr},
+        };
+        for (auto& method : methods) {
+            napi_value fn;
+            auto* data = new std::shared_ptr<BoundLimiter>(bound);
+            if (napi_create_function(env, method.utf8name, NAPI_AUTO_LENGTH, method.method, data, &fn) != napi_ok ||
+                napi_add_finalizer(env, fn, data, [](napi_env, void* ref, void*) {
+                    delete static_cast<std::shared_ptr<BoundLimiter>*>(ref);
+                }, nullptr, nullptr) != napi_ok) {
+                delete data;
+                throw std::runtime_error("Failed to bind limiter methods");
+            }
+            method.method = nullptr;
+            method.value = fn;
+        }
+        napi_define_properties(env, self, 2, methods);
+    }
+
+    static RateLimiter* BoundArgs(napi_env env, napi_callback_info info, size_t argc, napi_value* argv) {
+        void* data;
+        napi_get_cb_info(env, info, &argc, argv, nullptr, &data);
+        RateLimiter* limiter = (*static_cast<std::shared_ptr<BoundLimiter>*>(data))->limiter;
+        if (!limiter) {
+            napi_throw_error(env, nullptr, "HyperLimit instance has been released");
+        }
+        return limiter;
+    }
+
+    static napi_value BoundTryRequest(napi_env env, napi_callback_info info) {
+        napi_value argv[2];
+        RateLimiter* limiter = BoundArgs(env, info, 2, argv);
+        if (!limiter) return nullptr;
+
+        napi_valuetype type;
+        napi_typeof(env, argv[0], &type);
+        if (type != napi_string) {
+            napi_throw_type_error(env, nullptr, "Wrong arguments");
+            return nullptr;
+        }
+
+        StringArg key(Napi::Value(env, argv[0]));
+        StringArg ip(Napi::Value(env, argv[1]));
+        napi_value result;
+        napi_get_boolean(env, limiter->tryRequest(key, ip), &result);
+        return result;
+    }
+
+    static napi_value BoundTryRequestById(napi_env env, napi_callback_info info) {
+        napi_value argv[1];
+        RateLimiter* limiter = BoundArgs(env, info, 1, argv);
+        if (!limiter) return nullptr;
+
+        uint32_t id;
+        if (napi_get_value_uint32(env, argv[0], &id) != napi_ok) {
+            napi_throw_type_error(env, nullptr, "Wrong arguments");
+            return nullptr;
+        }
+
+        napi_value result;
+        napi_get_boolean(env, limiter->tryRequestById(id), &result);
+        return result;
+    }
+
+    Napi::Value TryRequest(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        StringArg ip(info[1]);
+
+        try {
+            bool allowed = rateLimiter->tryRequest(key, ip);
+            return Napi::Boolean::New(env, allowed);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // tryRequest as a Promise. Limiters without distributed storage are
+    // decided right away; the rest go to the StorageQueue.
+    Napi::Value TryRequestAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        StringArg ip(info[1]);
+
+        if (!rateLimiter->usesStorage(key)) {
+            auto deferred = Napi::Promise::Deferred::New(env);
+            deferred.Resolve(Napi::Boolean::New(env, rateLimiter->tryRequest(key, ip)));
+            return deferred.Promise();
+        }
+
+        return Storage(env).run<bool>(env, info.This().As<Napi::Object>(),
+            [limiter = rateLimiter, key = std::string(key), ip = std::string(ip)] {
+                return limiter->tryRequest(key, ip);
+            },
+            [](Napi::Env env, const bool& allowed) -> Napi::Value {
+                return Napi::Boolean::New(env, allowed);
+            });
+    }
+
+    // Ids are small integers, so the call converts one number and does no
+    // string work at all
+    Napi::Value TryRequestById(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            bool allowed = rateLimiter->tryRequestById(info[0].As<Napi::Number>().Uint32Value());
+            return Napi::Boolean::New(env, allowed);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // One lookup for the decision and the header values; the results go to
+    // the infoArray given to the constructor and only the decision is returned
+    Napi::Value TryRequestInfo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!infoDoubles && !infoInts) {
+            Napi::Error::New(env, "tryRequestInfo requires the infoArray option").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        StringArg ip(info[1]);
+
+        bool allowed;
+        auto limitInfo = rateLimiter->tryRequestInfo(key, ip, allowed);
+        WriteInfo(allowed, limitInfo);
+        return Napi::Boolean::New(env, allowed);
+    }
+
+    // Fill the infoArray for tryRequestInfo() and decide(): allowed, limit,
+    // remaining, reset as a Unix time in seconds and retryAfter in seconds,
+    // rounded up: the rest of a block, or until the next token of an empty
+    // bucket. Returns the reset written.
+    template <typename Info>
+    int64_t WriteInfo(bool allowed, const Info& limitInfo) {
+        const Clock& clock = rateLimiter->getClock();
+        const int64_t ticksPerSecond = 1000 * clock.ticksPerMs();
+        const int64_t reset = (clock.toEpochMs(limitInfo.reset) + 999) / 1000;
+        int64_t retryAfter = 0;
+        if (!allowed) {
+            retryAfter = std::max<int64_t>(1, (limitInfo.retryTicks + ticksPerSecond - 1) / ticksPerSecond);
+        }
+        if (infoDoubles) {
+            infoDoubles[0] = allowed ? 1 : 0;
+            infoDoubles[1] = static_cast<double>(limitInfo.limit);
+            infoDoubles[2] = static_cast<double>(limitInfo.remaining);
+            infoDoubles[3] = static_cast<double>(reset);
+            infoDoubles[4] = static_cast<double>(retryAfter);
+            if (infoLength > kInfoFields) infoDoubles[5] = resetAt(limitInfo.reset);
+        } else {
+            infoInts[0] = allowed ? 1 : 0;
+            infoInts[1] = limitInfo.limit;
+            infoInts[2] = limitInfo.remaining;
+            infoInts[3] = reset;
+            infoInts[4] = retryAfter;
+            if (infoLength > kInfoFields) infoInts[5] = static_cast<int64_t>(resetAt(limitInfo.reset));
+        }
+        return reset;
+    }
+
+    // Settings for decide(): { bypassKeys, maxTokens, window, sliding, block,
+    // maxPenalty, headers, legacyHeaders, standardHeaders }. With maxTokens,
+    // decide() creates missing limiters with these settings; they are
+    // evictable like the ones rules create. With headers, an array, decide()
+    // stores the header values there: X-RateLimit-Limit, -Remaining and
+    // -Reset when legacyHeaders (the default), then RateLimit-Policy and
+    // RateLimit when standardHeaders.
+    Napi::Value ConfigureDecide(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object options = info[0].As<Napi::Object>();
+        std::vector<std::string> tokens;
+        if (options.Get("bypassKeys").IsArray()) {
+            Napi::Array keys = options.Get("bypassKeys").As<Napi::Array>();
+            for (uint32_t i = 0; i < keys.Length(); i++) {
+                if (keys.Get(i).IsString()) tokens.push_back(keys.Get(i).As<Napi::String>().Utf8Value());
+            }
+        }
+
+        std::unique_ptr<RuleLimit> defaults;
+        if (options.Get("maxTokens").IsNumber()) {
+            defaults = std::make_unique<RuleLimit>();
+            defaults->maxTokens = options.Get("maxTokens").As<Napi::Number>().Int64Value();
+            defaults->window = options.Get("window").IsNumber() ? toTicks(options.Get("window")) : 0;
+            defaults->sliding = options.Get("sliding").IsBoolean() && options.Get("sliding").As<Napi::Boolean>().Value();
+            defaults->block = options.Get("block").IsNumber() ? toTicks(options.Get("block")) : 0;
+            defaults->maxPenalty = options.Get("maxPenalty").IsNumber() ?
+                options.Get("maxPenalty").As<Napi::Number>().Int64Value() : 0;
+            if (defaults->maxTokens < 0 || defaults->window <= 0 || defaults->block < 0) {
+                Napi::TypeError::New(env, "maxTokens, window and block must be valid limiter settings")
+                    .ThrowAsJavaScriptException();
+                return env.Null();
+            }
+        }
+
+        if (options.Get("headers").IsArray()) {
+            headerValues = Napi::Persistent(options.Get("headers").As<Napi::Array>());
+            legacyHeaders = !options.Get("legacyHeaders").IsBoolean() ||
+                            options.Get("legacyHeaders").As<Napi::Boolean>().Value();
+            standardHeaders = options.Get("standardHeaders").IsBoolean() &&
+                              options.Get("standardHeaders").As<Napi::Boolean>().Value();
+        } else {
+            headerValues.Reset();
+            legacyHeaders = standardHeaders = false;
+        }
+
+        bypassKeys.clear();
+        bypassStorage = std::move(tokens);
+        for (const std::string& token : bypassStorage) bypassKeys.insert(token);
+        decideDefaults = std::move(defaults);
+        return env.Undefined();
+    }
+
+    // One call per HTTP request: bypass check, creating the limiter if
+    // configureDecide() asked for it, the decision and the values of the
+    // rate limit headers. Returns 1 (allowed), 0 (rejected) or 2 (bypass
+    // token matched, nothing counted). The infoArray receives the values
+    // tryRequestInfo() writes.
+    Napi::Value Decide(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!infoDoubles && !infoInts) {
+            Napi::Error::New(env, "decide requires the infoArray option").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        if (!bypassKeys.empty() && info.Length() > 2 && info[2].IsString()) {
+            StringArg token(info[2]);
+            if (bypassKeys.count(token)) return Napi::Number::New(env, 2);
+        }
+
+        StringArg key(info[0]);
+        StringArg ip(info[1]);
+
+        try {
+            bool allowed;
+            auto limitInfo = decideDefaults ?
+                rateLimiter->tryRequestInfoOrCreate(key, ip, allowed, decideDefaults->maxTokens,
+                                                    decideDefaults->window, decideDefaults->sliding,
+                                                    decideDefaults->block, decideDefaults->maxPenalty) :
+                rateLimiter->tryRequestInfo(key, ip, allowed);
+
+            const int64_t reset = WriteInfo(allowed, limitInfo);
+            if (!headerValues.IsEmpty()) {
+                const Clock& clock = rateLimiter->getClock();
+                const int64_t ticksPerSecond = 1000 * clock.ticksPerMs();
+                const int64_t untilReset = std::max<int64_t>(0,
+                    (limitInfo.reset - clock.now() + ticksPerSecond - 1) / ticksPerSecond);
+                WriteHeaders(env, limitInfo.limit, limitInfo.remaining, reset, untilReset,
+                             (limitInfo.window + ticksPerSecond - 1) / ticksPerSecond);
+            }
+            return Napi::Number::New(env, allowed ? 1 : 0);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Header strings for decide(). RateLimit and RateLimit-Policy follow the
+    // IETF draft's structured fields with a single policy named "default":
+    // quota and window in seconds, remaining and seconds until reset.
+    void WriteHeaders(Napi::Env env, int64_t limit, int64_t remaining, int64_t resetEpoch,
+                      int64_t untilReset, int64_t windowSeconds) {
+        auto number = [](int64_t value) {
+            return [value](char* buffer, size_t size) {
+                return std::snprintf(buffer, size, "%lld", static_cast<long long>(value));
+            };
+        };
+        Napi::Array values = headerValues.Value();
+        if (legacyHeaders) {
+            values.Set(uint32_t(kLimitHeader), numberStrings.get(env, limit, 0, number(limit)));
+            values.Set(uint32_t(kRemainingHeader), numberStrings.get(env, remaining, 0, number(remaining)));
+            values.Set(uint32_t(kResetHeader), numberStrings.get(env, resetEpoch, 0, number(resetEpoch)));
+        }
+        if (standardHeaders) {
+            values.Set(uint32_t(kPolicyHeader), policyStrings.get(env, limit, windowSeconds, [&](char* buffer, size_t size) {
+                return std::snprintf(buffer, size, "\"default\";q=%lld;w=%lld",
+                                     static_cast<long long>(limit), static_cast<long long>(windowSeconds));
+            }));
+            values.Set(uint32_t(kRateLimitHeader), rateLimitStrings.get(env, remaining, untilReset, [&](char* buffer, size_t size) {
+                return std::snprintf(buffer, size, "\"default\";r=%lld;t=%lld",
+                                     static_cast<long long>(remaining), static_cast<long long>(untilReset));
+            }));
+        }
+    }
+
+    // Keys of a batch call come as an array of strings, copied back to back
+    // into one reused buffer, or as a Buffer of newline-separated keys, which
+    // is split in place. The views stay valid until the next call on this
+    // thread.
+    static const std::vector<std::string_view>& ReadKeyList(Napi::Env env, const Napi::Value& value) {
+        thread_local std::vector<std::string_view> keys;
+        thread_local std::vector<size_t> ends;
+        thread_local std::string text;
+        keys.clear();
+
+        if (value.IsBuffer()) {
+            auto buffer = value.As<Napi::Buffer<char>>();
+            std::string_view rest(buffer.Data(), buffer.Length());
+            while (!rest.empty()) {
+                size_t end = std::min(rest.find('\n'), rest.size());
+                keys.push_back(rest.substr(0, end));
+                rest.remove_prefix(std::min(end + 1, rest.size()));
+            }
+            return keys;
+        }
+
+        Napi::Array array = value.As<Napi::Array>();
+        const uint32_t count = array.Length();
+        text.clear();
+        ends.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            Napi::Value item = array.Get(i);
+            if (item.IsString()) {
+                size_t start = text.size();
+                size_t length = 0;
+                napi_get_value_string_utf8(env, item, nullptr, 0, &length);
+                text.resize(start + length + 1);
+                napi_get_value_string_utf8(env, item, &text[start], length + 1, &length);
+                text.resize(start + length);
+            }
+            ends.push_back(text.size());
+        }
+        // Views are taken once the buffer has stopped growing
+        size_t start = 0;
+        for (size_t end : ends) {
+            keys.emplace_back(text.data() + start, end - start);
+            start = end;
+        }
+        return keys;
+    }
+
+    // Keys as read by ReadKeyList. Costs are an optional array or Uint32Array
+    // with one entry per key. Returns a Uint8Array of 1 (allowed) and 0
+    // (rejected).
+    Napi::Value TryRequestBatch(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !(info[0].IsArray() || info[0].IsBuffer())) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        const std::vector<std::string_view>& keys = ReadKeyList(env, info[0]);
+        thread_local std::vector<int64_t> costs;
+
+        const int64_t* costData = nullptr;
+        if (info.Length() > 1 && !info[1].IsUndefined()) {
+            costs.clear();
+            if (info[1].IsTypedArray() &&
+                info[1].As<Napi::TypedArray>().TypedArrayType() == napi_uint32_array) {
+                auto typed = info[1].As<Napi::Uint32Array>();
+                for (size_t i = 0; i < typed.ElementLength(); i++) {
+                    costs.push_back(typed[i]);
+                }
+            } else if (info[1].IsArray()) {
+                Napi::Array array = info[1].As<Napi::Array>();
+                for (uint32_t i = 0; i < array.Length(); i++) {
+                    Napi::Value cost = array.Get(i);
+                    if (!cost.IsNumber()) {
+                        Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+                        return env.Null();
+                    }
+                    costs.push_back(cost.As<Napi::Number>().Int64Value());
+                    if (costs.back() < 0) {
+                        Napi::Error::New(env, "cost cannot be negative").ThrowAsJavaScriptException();
+                        return env.Null();
+                    }
+                }
+            } else {
+                Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            if (costs.size() != keys.size()) {
+                Napi::TypeError::New(env, "costs must have one entry per key").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            costData = costs.data();
+        }
+
+        Napi::Uint8Array results = Napi::Uint8Array::New(env, keys.size());
+        rateLimiter->tryRequestBatch(keys.data(), costData, keys.size(), results.Data());
+        return results;
+    }
+
+    // A Float64Array the caller passed to fill, or null after throwing if the
+    // argument is not one or holds fewer than length values
+    static Napi::Float64Array OutputArray(Napi::Env env, const Napi::Value& value, size_t length) {
+        if (!value.IsTypedArray() || value.As<Napi::TypedArray>().TypedArrayType() != napi_float64_array) {
+            Napi::TypeError::New(env, "Expected a Float64Array").ThrowAsJavaScriptException();
+            return Napi::Float64Array();
+        }
+        Napi::Float64Array array = value.As<Napi::Float64Array>();
+        if (array.ElementLength() < length) {
+            Napi::RangeError::New(env, "Float64Array needs " + std::to_string(length) + " elements")
+                .ThrowAsJavaScriptException();
+            return Napi::Float64Array();
+        }
+        return array;
+    }
+
+    // getRateLimitInfo for many keys, as a struct of arrays: for n keys,
+    // limits are at [0, n), remaining at [n, 2n), reset at [2n, 3n), blocked
+    // (1 or 0) at [3n, 4n), retryAfter at [4n, 5n) and resetAt at [5n, 6n),
+    // the last left out if into holds only 5n. Unknown keys have a
+    // limit and remaining of -1. Writes into into when given, so polling
+    // allocates nothing on the JS heap.
+    Napi::Value GetInfoMany(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !(info[0].IsArray() || info[0].IsBuffer())) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        const std::vector<std::string_view>& keys = ReadKeyList(env, info[0]);
+        const size_t n = keys.size();
+        Napi::Float64Array out;
+        if (info.Length() > 1 && !info[1].IsUndefined()) {
+            out = OutputArray(env, info[1], kInfoManyFields * n);
+            if (out.IsEmpty()) return env.Null();
+        } else {
+            out = Napi::Float64Array::New(env, (kInfoManyFields + 1) * n);
+        }
+        const bool withResetAt = out.ElementLength() >= (kInfoManyFields + 1) * n;
+
+        thread_local std::vector<LimitInfo> infos;
+        infos.resize(n);
+        rateLimiter->getRateLimitInfoBatch(keys.data(), n, infos.data());
+
+        double* data = out.Data();
+        for (size_t i = 0; i < n; i++) {
+            data[i] = static_cast<double>(infos[i].limit);
+            data[n + i] = static_cast<double>(infos[i].remaining);
+            data[2 * n + i] = toMs(infos[i].reset);
+            data[3 * n + i] = infos[i].blocked ? 1 : 0;
+            data[4 * n + i] = static_cast<double>(infos[i].retryAfter);
+            if (withResetAt) data[5 * n + i] = resetAt(infos[i].reset);
+        }
+        return out;
+    }
+
+    // Handles are Externals owning a RateLimiter::Handle; the GC frees the
+    // state together with the connection object holding it. A handle keeps
+    // the limiter that made it: another instance would apply its own clock
+    // and tick resolution to the handle's state.
+    struct OwnedHandle {
+        std::unique_ptr<RateLimiter::Handle> handle;
+        std::weak_ptr<RateLimiter> owner;
+    };
+
+    // Whether owner is this instance's limiter; compares control blocks, so
+    // the check takes no reference
+    bool ownedHere(const std::weak_ptr<RateLimiter>& owner) const noexcept {
+        return !owner.owner_before(rateLimiter) && !rateLimiter.owner_before(owner);
+    }
+
+    Napi::Value CreateHandle(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t maxTokens = info[0].As<Napi::Number>().Int64Value();
+        int64_t refillTime = toTicks(info[1]);
+        bool useSlidingWindow = info.Length() > 2 && info[2].IsBoolean() ? info[2].As<Napi::Boolean>().Value() : false;
+        int64_t blockDuration = info.Length() > 3 && info[3].IsNumber() ? toTicks(info[3]) : 0;
+        int64_t maxPenaltyPoints = info.Length() > 4 && info[4].IsNumber() ? info[4].As<Napi::Number>().Int64Value() : 0;
+
+        try {
+            auto handle = rateLimiter->createHandle(maxTokens, refillTime, useSlidingWindow,
+                                                    blockDuration, maxPenaltyPoints);
+            // Let the GC know what a handle really costs so that millions of
+            // small JS objects do not hide their native state
+            constexpr int64_t kHandleSize = sizeof(OwnedHandle) + sizeof(RateLimiter::Handle);
+            auto owned = new OwnedHandle{std::move(handle), rateLimiter};
+            Napi::MemoryManagement::AdjustExternalMemory(env, kHandleSize);
+            return tagExternal(Napi::External<OwnedHandle>::New(env, owned,
+                [](Napi::Env env, OwnedHandle* owned) {
+                    delete owned;
+                    Napi::MemoryManagement::AdjustExternalMemory(env, -kHandleSize);
+                }), kHandleTag);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value Consume(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        OwnedHandle* owned = info.Length() > 0 ? taggedExternal<OwnedHandle>(info[0], kHandleTag) : nullptr;
+        if (!owned) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!ownedHere(owned->owner)) {
+            Napi::Error::New(env, "Handle belongs to another HyperLimit instance").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return Napi::Boolean::New(env, rateLimiter->consume(*owned->handle));
+    }
+
+    // Key tables are Externals owning a FixedKeyTable of the requested key
+    // width; like handles, the GC frees them, and their durations are ticks
+    // of the limiter that made them
+    using KeyTable = std::variant<std::unique_ptr<FixedKeyTable<uint32_t>>,
+                                  std::unique_ptr<FixedKeyTable<uint64_t>>,
+                                  std::unique_ptr<FixedKeyTable<Key128>>>;
+
+    struct OwnedKeyTable {
+        KeyTable table;
+        std::weak_ptr<RateLimiter> owner;
+    };
+
+    // The key table passed as value, or null after throwing
+    OwnedKeyTable* keyTableArg(Napi::Env env, const Napi::Value& value) {
+        OwnedKeyTable* owned = taggedExternal<OwnedKeyTable>(value, kKeyTableTag);
+        if (!owned) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return nullptr;
+        }
+        if (!ownedHere(owned->owner)) {
+            Napi::Error::New(env, "Key table belongs to another HyperLimit instance").ThrowAsJavaScriptException();
+            return nullptr;
+        }
+        return owned;
+    }
+
+    static uint64_t loadBigEndian(const uint8_t* bytes, size_t length) noexcept {
+        uint64_t value = 0;
+        for (size_t i = 0; i < length; i++) value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    // IPv4 keys: a uint32 number, a 4-byte buffer in network order or text
+    static bool readKey(const Napi::Value& value, uint32_t& key) {
+        if (value.IsNumber()) {
+            double number = value.As<Napi::Number>().DoubleValue();
+            if (!(number >= 0 && number <= 4294967295.0) || number != std::floor(number)) return false;
+            key = static_cast<uint32_t>(number);
+            return true;
+        }
+        if (value.IsBuffer()) {
+            Napi::Buffer<uint8_t> buffer = value.As<Napi::Buffer<uint8_t>>();
+            if (buffer.Length() != 4) return false;
+            key = static_cast<uint32_t>(loadBigEndian(buffer.Data(), 4));
+            return true;
+        }
+        return value.IsString() && parseIPv4(StringArg(value), key);
+    }
+
+    // Integer ids: a non-negative safe integer, a BigInt or an 8-byte buffer
+    static bool readKey(const Napi::Value& value, uint64_t& key) {
+        if (value.IsNumber()) {
+            double number = value.As<Napi::Number>().DoubleValue();
+            if (!(number >= 0 && number <= 9007199254740991.0) || number != std::floor(number)) return false;
+            key = static_cast<uint64_t>(number);
+            return true;
+        }
+        if (value.IsBigInt()) {
+            bool lossless = false;
+            key = value.As<Napi::BigInt>().Uint64Value(&lossless);
+            return lossless;
+        }
+        if (value.IsBuffer()) {
+            Napi::Buffer<uint8_t> buffer = value.As<Napi::Buffer<uint8_t>>();
+            if (buffer.Length() != 8) return false;
+            key = loadBigEndian(buffer.Data(), 8);
+            return true;
+        }
+        return false;
+    }
+
+    // IPv6 keys: a 16-byte buffer, a BigInt or text. IPv4 addresses, as
+    // 4-byte buffers or text, are stored IPv4-mapped so one table serves a
+    // dual-stack server.
+    static bool readKey(const Napi::Value& value, Key128& key) {
+        if (value.IsBuffer()) {
+            Napi::Buffer<uint8_t> buffer = value.As<Napi::Buffer<uint8_t>>();
+            if (buffer.Length() == 4) {
+                key = mapIPv4(static_cast<uint32_t>(loadBigEndian(buffer.Data(), 4)));
+                return true;
+            }
+            if (buffer.Length() != 16) return false;
+            key = Key128{loadBigEndian(buffer.Data(), 8), loadBigEndian(buffer.Data() + 8, 8)};
+            return true;
+        }
+        if (value.IsBigInt()) {
+            Napi::BigInt number = value.As<Napi::BigInt>();
+            if (number.WordCount() > 2) return false;
+            int sign = 0;
+            size_t count = 2;
+            uint64_t words[2] = {0, 0};
+            number.ToWords(&sign, &count, words);
+            if (sign) return false;
+            key = Key128{words[1], words[0]};
+            return true;
+        }
+        if (value.IsString()) {
+            StringArg text(value);
+            uint32_t v4;
+            if (parseIPv4(text, v4)) {
+                key = mapIPv4(v4);
+                return true;
+            }
+            return parseIPv6(text, key);
+        }
+        return false;
+    }
+
+    Napi::Value CreateKeyTable(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string type = info[0].As<Napi::String>().Utf8Value();
+        int64_t maxTokens = info[1].As<Napi::Number>().Int64Value();
+        int64_t refillTime = toTicks(info[2]);
+        bool useSlidingWindow = info.Length() > 3 && info[3].IsBoolean() ? info[3].As<Napi::Boolean>().Value() : false;
+        int64_t blockDuration = info.Length() > 4 && info[4].IsNumber() ? toTicks(info[4]) : 0;
+
+        try {
+            auto owned = std::make_unique<OwnedKeyTable>();
+            if (type == "ipv4") {
+                owned->table = std::make_unique<FixedKeyTable<uint32_t>>(maxTokens, refillTime, useSlidingWindow, blockDuration);
+            } else if (type == "u64") {
+                owned->table = std::make_unique<FixedKeyTable<uint64_t>>(maxTokens, refillTime, useSlidingWindow, blockDuration);
+            } else if (type == "ipv6") {
+                owned->table = std::make_unique<FixedKeyTable<Key128>>(maxTokens, refillTime, useSlidingWindow, blockDuration);
+            } else {
+                Napi::TypeError::New(env, "type must be 'ipv4', 'ipv6' or 'u64'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            owned->owner = rateLimiter;
+            return tagExternal(Napi::External<OwnedKeyTable>::New(env, owned.release(),
+                [](Napi::Env, OwnedKeyTable* owned) { delete owned; }), kKeyTableTag);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value TryRequestKey(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        OwnedKeyTable* owned = keyTableArg(env, info[0]);
+        if (!owned) return env.Null();
+        KeyTable* table = &owned->table;
+        const int64_t now = rateLimiter->getClock().now();
+        try {
+            // -1: the key does not fit the table
+            int result = std::visit([&](auto& keyTable) -> int {
+                typename std::decay_t<decltype(*keyTable)>::KeyType key;
+                if (!readKey(info[1], key)) return -1;
+                return keyTable->tryRequest(key, now) ? 1 : 0;
+            }, *table);
+            if (result < 0) {
+                Napi::TypeError::New(env, "Invalid key for this table").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            rateLimiter->countDecision(result == 1);
+            return Napi::Boolean::New(env, result == 1);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value GetKeyTokens(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        OwnedKeyTable* owned = keyTableArg(env, info[0]);
+        if (!owned) return env.Null();
+        KeyTable* table = &owned->table;
+        const int64_t now = rateLimiter->getClock().now();
+        int64_t tokens = std::visit([&](auto& keyTable) -> int64_t {
+            typename std::decay_t<decltype(*keyTable)>::KeyType key;
+            if (!readKey(info[1], key)) return -1;
+            return keyTable->getTokens(key, now);
+        }, *table);
+        if (tokens < 0) {
+            Napi::TypeError::New(env, "Invalid key for this table").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return Napi::Number::New(env, static_cast<double>(tokens));
+    }
+
+    // Binary form of a textual IP address: a 4-byte buffer for IPv4, 16
+    // bytes for IPv6, null when the text is not an address
+    static Napi::Value ParseIp(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg text(info[0]);
+        uint8_t bytes[16];
+        uint32_t v4;
+        if (parseIPv4(text, v4)) {
+            for (int i = 0; i < 4; i++) bytes[i] = static_cast<uint8_t>(v4 >> (24 - 8 * i));
+            return Napi::Buffer<uint8_t>::Copy(env, bytes, 4);
+        }
+        Key128 v6;
+        if (parseIPv6(text, v6)) {
+            for (int i = 0; i < 8; i++) {
+                bytes[i] = static_cast<uint8_t>(v6.hi >> (56 - 8 * i));
+                bytes[8 + i] = static_cast<uint8_t>(v6.lo >> (56 - 8 * i));
+            }
+            return Napi::Buffer<uint8_t>::Copy(env, bytes, 16);
+        }
+        return env.Null();
+    }
+
+    // Shared tables are Externals owning a mapping of a shared-memory
+    // segment; the GC unmaps them, unlinkSharedTable removes the segment.
+    // Their durations are always milliseconds.
+    Napi::Value OpenSharedTable(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string name = info[0].As<Napi::String>().Utf8Value();
+        int64_t capacity = info.Length() > 1 && info[1].IsNumber() ? info[1].As<Napi::Number>().Int64Value() : 4096;
+
+        try {
+            auto table = std::make_unique<SharedMemoryTable>(name, static_cast<size_t>(std::max<int64_t>(capacity, 0)));
+            return tagExternal(Napi::External<SharedMemoryTable>::New(env, table.release(),
+                [](Napi::Env, SharedMemoryTable* table) { delete table; }), kSharedTableTag);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    static SharedMemoryTable* sharedTableArg(const Napi::Value& value) {
+        return taggedExternal<SharedMemoryTable>(value, kSharedTableTag);
+    }
+
+    Napi::Value CreateSharedLimiter(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        SharedMemoryTable* table = info.Length() >= 4 ? sharedTableArg(info[0]) : nullptr;
+        if (!table || !info[1].IsString() || !info[2].IsNumber() || !info[3].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[1]);
+        int64_t maxTokens = info[2].As<Napi::Number>().Int64Value();
+        int64_t refillTime = info[3].As<Napi::Number>().Int64Value();
+        bool useSlidingWindow = info.Length() > 4 && info[4].IsBoolean() ? info[4].As<Napi::Boolean>().Value() : false;
+        int64_t blockDuration = info.Length() > 5 && info[5].IsNumber() ? info[5].As<Napi::Number>().Int64Value() : 0;
+
+        try {
+            table->createLimiter(key, maxTokens, refillTime, useSlidingWindow, blockDuration);
+            return env.Undefined();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value RemoveSharedLimiter(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        SharedMemoryTable* table = info.Length() >= 2 ? sharedTableArg(info[0]) : nullptr;
+        if (!table || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            table->removeLimiter(StringArg(info[1]));
+            return env.Undefined();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value TryRequestShared(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        SharedMemoryTable* table = info.Length() >= 2 ? sharedTableArg(info[0]) : nullptr;
+        if (!table || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool allowed = table->tryRequest(StringArg(info[1]));
+        rateLimiter->countDecision(allowed);
+        return Napi::Boolean::New(env, allowed);
+    }
+
+    Napi::Value GetSharedTokens(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        SharedMemoryTable* table = info.Length() >= 2 ? sharedTableArg(info[0]) : nullptr;
+        if (!table || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t tokens = table->getTokens(StringArg(info[1]));
+        return Napi::Number::New(env, static_cast<double>(tokens));
+    }
+
+    // Counters kept in the segment, so they cover every attached process
+    Napi::Value GetSharedStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        SharedMemoryTable* table = info.Length() >= 1 ? sharedTableArg(info[0]) : nullptr;
+        if (!table) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        SharedMemoryTable::Stats stats = table->getStats();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("totalRequests", Napi::Number::New(env, static_cast<double>(stats.totalRequests)));
+        result.Set("allowedRequests", Napi::Number::New(env, static_cast<double>(stats.allowedRequests)));
+        result.Set("blockedRequests", Napi::Number::New(env, static_cast<double>(stats.blockedRequests)));
+        result.Set("limiters", Napi::Number::New(env, stats.limiters));
+        result.Set("capacity", Napi::Number::New(env, stats.capacity));
+        return result;
+    }
+
+    static Napi::Value UnlinkSharedTable(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return Napi::Boolean::New(env, SharedMemoryTable::unlink(info[0].As<Napi::String>().Utf8Value()));
+    }
+
+    static std::string stringProperty(const Napi::Object& object, const char* name) {
+        Napi::Value value = object.Get(name);
+        return value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+    }
+
+    static int64_t numberProperty(const Napi::Object& object, const char* name) {
+        Napi::Value value = object.Get(name);
+        return value.IsNumber() ? value.As<Napi::Number>().Int64Value() : 0;
+    }
+
+    Napi::Value LoadRules(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Array list = info[0].As<Napi::Array>();
+        std::vector<RuleSpec> specs;
+        specs.reserve(list.Length());
+
+        for (uint32_t i = 0; i < list.Length(); i++) {
+            if (!list.Get(i).IsObject()) {
+                Napi::TypeError::New(env, "Each rule must be an object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            Napi::Object rule = list.Get(i).As<Napi::Object>();
+            RuleSpec spec;
+            spec.name = stringProperty(rule, "name");
+            spec.path = stringProperty(rule, "path");
+            spec.key = stringProperty(rule, "key");
+
+            Napi::Value method = rule.Get("method");
+            if (method.IsString()) {
+                spec.methods.push_back(method.As<Napi::String>().Utf8Value());
+            } else if (method.IsArray()) {
+                Napi::Array methods = method.As<Napi::Array>();
+                for (uint32_t m = 0; m < methods.Length(); m++) {
+                    spec.methods.push_back(methods.Get(m).As<Napi::String>().Utf8Value());
+                }
+            }
+
+            Napi::Value headers = rule.Get("headers");
+            if (headers.IsObject()) {
+                Napi::Object headerObject = headers.As<Napi::Object>();
+                Napi::Array names = headerObject.GetPropertyNames();
+                for (uint32_t h = 0; h < names.Length(); h++) {
+                    std::string name = names.Get(h).As<Napi::String>().Utf8Value();
+                    spec.headers.emplace_back(name, stringProperty(headerObject, name.c_str()));
                 }
             }
+
+            spec.limit.maxTokens = numberProperty(rule, "maxTokens");
+            spec.limit.window = rule.Get("window").IsNumber() ? toTicks(rule.Get("window")) : 0;
+            spec.limit.sliding = rule.Get("sliding").IsBoolean() && rule.Get("sliding").As<Napi::Boolean>().Value();
+            spec.limit.block = rule.Get("block").IsNumber() ? toTicks(rule.Get("block")) : 0;
+            spec.limit.maxPenalty = numberProperty(rule, "maxPenalty");
+            specs.push_back(std::move(spec));
         }
 
         try {
-            rateLimiter = std::make_unique<RateLimiter>(bucketCount, storage.release());
+            rules = std::make_unique<RuleSet>(specs);
+            return Napi::Boolean::New(env, true);
         } catch (const std::exception& e) {
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
         }
     }
 
-private:
-    std::unique_ptr<RateLimiter> rateLimiter;
-
-    Napi::Value CreateLimiter(const Napi::CallbackInfo& info) {
+    // Returns the limiter key of the first matching rule, creating or
+    // reconfiguring that limiter as needed, or null if no rule matches
+    Napi::Value MatchRule(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        if (info.Length() < 3) {
-            Napi::TypeError::New(env, "Wrong number of arguments")
-                .ThrowAsJavaScriptException();
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!rules) {
             return env.Null();
         }
 
-        if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber()) {
+        StringArg method(info[0]);
+        StringArg path(info[1]);
+        StringArg client(info[3]);
+
+        // Only the headers some rule refers to cross into native code
+        const std::vector<std::string>& names = rules->headers();
+        headerBuffer.resize(names.size());
+        std::vector<std::string_view> headerValues(names.size());
+        if (info.Length() > 2 && info[2].IsObject()) {
+            Napi::Object headers = info[2].As<Napi::Object>();
+            for (size_t i = 0; i < names.size(); i++) {
+                Napi::Value value = headers.Get(names[i]);
+                headerBuffer[i] = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+                headerValues[i] = headerBuffer[i];
+            }
+        }
+
+        try {
+            std::string key;
+            const RuleLimit* limit = rules->match(method, path, client, headerValues, key);
+            if (!limit) {
+                return env.Null();
+            }
+            // Shared through the storage like the middlewares' own limiters
+            const std::string distributedKey = rateLimiter->hasStorage() ? key + ":distributed" : "";
+            rateLimiter->ensureLimiter(key, limit->maxTokens, limit->window, limit->sliding,
+                                       limit->block, limit->maxPenalty, distributedKey);
+            return Napi::String::New(env, key);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value SetStriping(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
             Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
             return env.Null();
         }
 
         std::string key = info[0].As<Napi::String>().Utf8Value();
-        int64_t maxTokens = info[1].As<Napi::Number>().Int64Value();
-        int64_t refillTimeMs = info[2].As<Napi::Number>().Int64Value();
-        bool useSlidingWindow = info.Length() > 3 && info[3].IsBoolean() ? info[3].As<Napi::Boolean>().Value() : false;
-        int64_t blockDurationMs = info.Length() > 4 && info[4].IsNumber() ? info[4].As<Napi::Number>().Int64Value() : 0;
-        int64_t maxPenaltyPoints = info.Length() > 5 && info[5].IsNumber() ? info[5].As<Napi::Number>().Int64Value() : 0;
-        std::string distributedKey = info.Length() > 6 && info[6].IsString() ? info[6].As<Napi::String>().Utf8Value() : "";
+        uint32_t stripes = info[1].As<Napi::Number>().Uint32Value();
+        int64_t batch = info.Length() > 2 && info[2].IsNumber() ? info[2].As<Napi::Number>().Int64Value() : 0;
 
         try {
-            rateLimiter->createLimiter(key, maxTokens, refillTimeMs, useSlidingWindow, blockDurationMs, maxPenaltyPoints, distributedKey);
+            rateLimiter->setStriping(key, stripes, batch);
             return Napi::Boolean::New(env, true);
         } catch (const std::exception& e) {
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -163,18 +1812,21 @@ private:
         }
     }
 
-    Napi::Value RemoveLimiter(const Napi::CallbackInfo& info) {
+    Napi::Value CreateBandwidthLimiter(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        if (info.Length() < 1 || !info[0].IsString()) {
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
             Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
             return env.Null();
         }
 
         std::string key = info[0].As<Napi::String>().Utf8Value();
+        int64_t bytesPerSecond = info[1].As<Napi::Number>().Int64Value();
+        int64_t burstBytes = info.Length() > 2 && info[2].IsNumber() ?
+            info[2].As<Napi::Number>().Int64Value() : bytesPerSecond;
 
         try {
-            rateLimiter->removeLimiter(key);
+            rateLimiter->createBandwidthLimiter(key, bytesPerSecond, burstBytes);
             return Napi::Boolean::New(env, true);
         } catch (const std::exception& e) {
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -182,26 +1834,103 @@ private:
         }
     }
 
-    Napi::Value TryRequest(const Napi::CallbackInfo& info) {
+    // createBandwidthLimiter for limiters made per client on demand: leaves an
+    // up-to-date limiter alone and lets maintenance evict it once idle.
+    // Returns true if it had to (re)create it.
+    Napi::Value EnsureBandwidthLimiter(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        if (info.Length() < 1 || !info[0].IsString()) {
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
             Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
             return env.Null();
         }
 
         std::string key = info[0].As<Napi::String>().Utf8Value();
-        std::string ip = info.Length() > 1 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "";
+        int64_t bytesPerSecond = info[1].As<Napi::Number>().Int64Value();
+        int64_t burstBytes = info.Length() > 2 && info[2].IsNumber() ?
+            info[2].As<Napi::Number>().Int64Value() : bytesPerSecond;
 
         try {
-            bool allowed = rateLimiter->tryRequest(key, ip);
-            return Napi::Boolean::New(env, allowed);
+            return Napi::Boolean::New(env, rateLimiter->ensureBandwidthLimiter(key, bytesPerSecond, burstBytes));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value ConsumeBytes(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        int64_t bytes = info[1].As<Napi::Number>().Int64Value();
+
+        try {
+            int64_t delay = rateLimiter->consumeBytes(key, bytes);
+            return Napi::Number::New(env, toMs(delay));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value Charge(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        int64_t cost = info[1].As<Napi::Number>().Int64Value();
+
+        try {
+            int64_t remaining = rateLimiter->charge(key, cost);
+            return Napi::Number::New(env, remaining);
         } catch (const std::exception& e) {
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
             return env.Null();
         }
     }
 
+    // charge as a Promise, like tryRequestAsync: a limiter without
+    // distributed storage is charged right away, the rest on the
+    // StorageQueue, since both the refill and the debit may make round trips
+    Napi::Value ChargeAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+        int64_t cost = info[1].As<Napi::Number>().Int64Value();
+
+        if (!rateLimiter->usesStorage(key)) {
+            auto deferred = Napi::Promise::Deferred::New(env);
+            try {
+                deferred.Resolve(Napi::Number::New(env, rateLimiter->charge(key, cost)));
+            } catch (const std::exception& e) {
+                deferred.Reject(Napi::Error::New(env, e.what()).Value());
+            }
+            return deferred.Promise();
+        }
+
+        return Storage(env).run<int64_t>(env, info.This().As<Napi::Object>(),
+            [limiter = rateLimiter, key = std::string(key), cost] {
+                return limiter->charge(key, cost);
+            },
+            [](Napi::Env env, const int64_t& remaining) -> Napi::Value {
+                return Napi::Number::New(env, remaining);
+            });
+    }
+
     Napi::Value GetTokens(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -210,7 +1939,7 @@ private:
             return env.Null();
         }
 
-        std::string key = info[0].As<Napi::String>().Utf8Value();
+        StringArg key(info[0]);
 
         try {
             int64_t tokens = rateLimiter->getTokens(key);
@@ -229,7 +1958,7 @@ private:
             return env.Null();
         }
 
-        std::string key = info[0].As<Napi::String>().Utf8Value();
+        StringArg key(info[0]);
 
         try {
             int64_t limit = rateLimiter->getCurrentLimit(key);
@@ -248,19 +1977,73 @@ private:
             return env.Null();
         }
         
-        std::string key = info[0].As<Napi::String>();
-        auto hyperlimit = Unwrap(info.This().As<Napi::Object>());
-        auto limitInfo = hyperlimit->rateLimiter->getRateLimitInfo(key);
-        
+        StringArg key(info[0]);
+        return RateLimitInfoObject(env, rateLimiter->getRateLimitInfo(key));
+    }
+
+    using LimitInfo = decltype(std::declval<RateLimiter&>().getRateLimitInfo({}));
+
+    // getRateLimitInfo as a Promise; the refill it runs first may sync with
+    // distributed storage
+    Napi::Value GetRateLimitInfoAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "String expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        StringArg key(info[0]);
+
+        if (!rateLimiter->usesStorage(key)) {
+            auto deferred = Napi::Promise::Deferred::New(env);
+            deferred.Resolve(RateLimitInfoObject(env, rateLimiter->getRateLimitInfo(key)));
+            return deferred.Promise();
+        }
+
+        return Storage(env).run<LimitInfo>(env, info.This().As<Napi::Object>(),
+            [limiter = rateLimiter, key = std::string(key)] {
+                return limiter->getRateLimitInfo(key);
+            },
+            [this](Napi::Env env, const LimitInfo& limitInfo) -> Napi::Value {
+                return RateLimitInfoObject(env, limitInfo);
+            });
+    }
+
+    Napi::Value GetTokensById(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t tokens = rateLimiter->getTokensById(info[0].As<Napi::Number>().Uint32Value());
+        return Napi::Number::New(env, tokens);
+    }
+
+    Napi::Value GetInfoById(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return RateLimitInfoObject(env, rateLimiter->getRateLimitInfoById(info[0].As<Napi::Number>().Uint32Value()));
+    }
+
+    template <typename Info>
+    Napi::Object RateLimitInfoObject(Napi::Env env, const Info& limitInfo) {
         auto result = Napi::Object::New(env);
         result.Set("limit", Napi::Number::New(env, limitInfo.limit));
         result.Set("remaining", Napi::Number::New(env, limitInfo.remaining));
-        result.Set("reset", Napi::Number::New(env, limitInfo.reset));
+        result.Set("reset", Napi::Number::New(env, toMs(limitInfo.reset)));
+        result.Set("resetAt", Napi::Number::New(env, resetAt(limitInfo.reset)));
         result.Set("blocked", Napi::Boolean::New(env, limitInfo.blocked));
         if (limitInfo.retryAfter > 0) {
             result.Set("retryAfter", Napi::Number::New(env, limitInfo.retryAfter));
         }
-        
         return result;
     }
 
@@ -418,11 +2201,194 @@ private:
         }
     }
 
+    Napi::Value SetTenantWeight(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string poolKey = info[0].As<Napi::String>().Utf8Value();
+        std::string tenant = info[1].As<Napi::String>().Utf8Value();
+        int64_t weight = info[2].As<Napi::Number>().Int64Value();
+
+        try {
+            rateLimiter->setTenantWeight(poolKey, tenant, weight);
+            return Napi::Boolean::New(env, true);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value TryRequestFairShare(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string poolKey = info[0].As<Napi::String>().Utf8Value();
+        std::string tenant = info[1].As<Napi::String>().Utf8Value();
+
+        try {
+            bool allowed = rateLimiter->tryRequestFairShare(poolKey, tenant);
+            return Napi::Boolean::New(env, allowed);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value GetFairShareInfo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string poolKey = info[0].As<Napi::String>().Utf8Value();
+        std::string tenant = info[1].As<Napi::String>().Utf8Value();
+
+        try {
+            auto shareInfo = rateLimiter->getFairShareInfo(poolKey, tenant);
+            auto result = Napi::Object::New(env);
+            result.Set("weight", Napi::Number::New(env, shareInfo.weight));
+            result.Set("share", Napi::Number::New(env, shareInfo.share));
+            result.Set("used", Napi::Number::New(env, shareInfo.used));
+            result.Set("activeWeight", Napi::Number::New(env, shareInfo.activeWeight));
+            return result;
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Current reading of the limiter's clock in milliseconds, fractional at
+    // finer resolutions; handy for timing against the same time base
+    Napi::Value Now(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), toMs(rateLimiter->getClock().now()));
+    }
+
+    Napi::Value AdvanceTime(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            rateLimiter->advanceTime(toTicks(info[0]));
+            return Napi::Number::New(env, toMs(rateLimiter->getClock().now()));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Run one maintenance sweep now, e.g. between advanceTime() steps
+    Napi::Value RunMaintenance(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        size_t batch = info.Length() > 0 && info[0].IsNumber() ?
+            static_cast<size_t>(std::max(int64_t(0), info[0].As<Napi::Number>().Int64Value())) : SIZE_MAX;
+        int64_t idleTimeout = info.Length() > 1 && info[1].IsNumber() ? toTicks(info[1]) : 0;
+
+        try {
+            auto result = rateLimiter->maintain(batch, idleTimeout);
+            Napi::Object stats = Napi::Object::New(env);
+            stats.Set("swept", Napi::Number::New(env, static_cast<double>(result.swept)));
+            stats.Set("unblocked", Napi::Number::New(env, static_cast<double>(result.unblocked)));
+            stats.Set("evicted", Napi::Number::New(env, static_cast<double>(result.evicted)));
+            return stats;
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Subscribe to block, unblock and penalty events: callback(events,
+    // dropped) every interval ms (default 100) that saw any. capacity
+    // (default 4096) bounds the events buffered between deliveries. A new
+    // subscription replaces this instance's previous one; instances attached
+    // to the same shared limiter subscribe independently.
+    Napi::Value OnEvents(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsFunction()) {
+            Napi::TypeError::New(env, "Wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t interval = 100;
+        int64_t capacity = 4096;
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Object options = info[1].As<Napi::Object>();
+            if (options.Get("interval").IsNumber()) interval = options.Get("interval").As<Napi::Number>().Int64Value();
+            if (options.Get("capacity").IsNumber()) capacity = options.Get("capacity").As<Napi::Number>().Int64Value();
+        }
+        if (interval <= 0 || capacity <= 0) {
+            Napi::TypeError::New(env, "interval and capacity must be positive").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            eventPump.reset();
+            eventPump = std::make_unique<EventPump>(env, info[0].As<Napi::Function>(), rateLimiter,
+                                                    interval, static_cast<size_t>(capacity));
+            return env.Undefined();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Stop the subscription, delivering events already recorded
+    Napi::Value OffEvents(const Napi::CallbackInfo& info) {
+        eventPump.reset();
+        return info.Env().Undefined();
+    }
+
+    // Clock actually in use: a 'tsc' request reports 'steady' on CPUs
+    // without an invariant counter
+    Napi::Value GetClock(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        static const char* const kSources[] = {"steady", "coarse", "cached", "tsc", "manual"};
+        static const char* const kResolutions[] = {"ms", "us", "ns"};
+
+        const Clock& clock = rateLimiter->getClock();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("source", Napi::String::New(env, kSources[static_cast<int>(clock.getSource())]));
+        result.Set("resolution", Napi::String::New(env, kResolutions[static_cast<int>(clock.getResolution())]));
+        return result;
+    }
+
+    // With a Float64Array, writes totalRequests, allowedRequests,
+    // blockedRequests, penalizedRequests, allowRate, blockRate, penaltyRate
+    // and heapStringCopies into it instead of allocating an object
     Napi::Value GetStats(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
         try {
             auto stats = rateLimiter->getStats();
+            if (info.Length() > 0 && !info[0].IsUndefined()) {
+                Napi::Float64Array out = OutputArray(env, info[0], kStatsFields);
+                if (out.IsEmpty()) return env.Null();
+                double* data = out.Data();
+                data[0] = static_cast<double>(stats.totalRequests);
+                data[1] = static_cast<double>(stats.allowedRequests);
+                data[2] = static_cast<double>(stats.blockedRequests);
+                data[3] = static_cast<double>(stats.penalizedRequests);
+                data[4] = stats.allowRate;
+                data[5] = stats.blockRate;
+                data[6] = stats.penaltyRate;
+                data[7] = static_cast<double>(heapStringCopies.load(std::memory_order_relaxed));
+                return out;
+            }
             auto result = Napi::Object::New(env);
             result.Set("totalRequests", stats.totalRequests);
             result.Set("allowedRequests", stats.allowedRequests);
@@ -431,6 +2397,7 @@ private:
             result.Set("allowRate", stats.allowRate);
             result.Set("blockRate", stats.blockRate);
             result.Set("penaltyRate", stats.penaltyRate);
+            result.Set("heapStringCopies", static_cast<double>(heapStringCopies.load(std::memory_order_relaxed)));
             return result;
         } catch (const std::exception& e) {
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -438,6 +2405,41 @@ private:
         }
     }
 
+    Napi::Value GetTableStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            auto stats = rateLimiter->getTableStats();
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("capacity", Napi::Number::New(env, static_cast<double>(stats.capacity)));
+            result.Set("limiters", Napi::Number::New(env, static_cast<double>(stats.limiters)));
+            result.Set("tombstones", Napi::Number::New(env, static_cast<double>(stats.tombstones)));
+            result.Set("maxProbeLength", Napi::Number::New(env, static_cast<double>(stats.maxProbeLength)));
+            return result;
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Token another thread passes as the shared option to attach to this
+    // limiter; it can travel in workerData or a message. Attached instances
+    // see the same limiters, ids, IP lists and stats. Rules, key tables,
+    // handles and the infoArray stay with the instance that made them.
+    Napi::Value Share(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::mutex> lock(sharedLimitersMutex);
+        for (auto it = sharedLimiters.begin(); it != sharedLimiters.end();) {
+            it = it->second.expired() ? sharedLimiters.erase(it) : std::next(it);
+        }
+        if (!shareToken) {
+            shareToken = nextShareToken++;
+            sharedLimiters.emplace(shareToken, rateLimiter);
+        }
+        return Napi::Number::New(env, shareToken);
+    }
+
     Napi::Value ResetStats(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -133,7 +133,7 @@ public:
         if (nc) g_natsLoader.natsConnection_Destroy(nc);
     }
 
-    bool tryAcquire(const std::string& key, int64_t tokens) override {
+    bool tryAcquire(const std::string& key, int64_t maxTokens, int64_t cost) override {
         if (!kv) return false; // Safety check
         
         // NATS JetStream KV Store does not allow colons in key names
@@ -147,8 +147,8 @@ public:
         s = g_natsLoader.kvStore_Get(&entry, kv, fullKey.c_str());
         
         if (s == NATS_NOT_FOUND) {
-            // Key doesn't exist, initialize it with maxTokens, then decrement by 1
-            std::string value = std::to_string(tokens);
+            // Key doesn't exist, initialize it with maxTokens, then decrement by cost
+            std::string value = std::to_string(maxTokens);
             uint64_t rev;
             s = g_natsLoader.kvStore_CreateString(&rev, kv, fullKey.c_str(), value.c_str());
             
@@ -156,9 +156,9 @@ public:
                 return false;
             }
             
-            // Now decrement by 1 (acquiring 1 token)
-            if (tokens > 0) {
-                std::string newValue = std::to_string(tokens - 1);
+            // Now decrement by cost (acquiring cost tokens)
+            if (maxTokens >= cost) {
+                std::string newValue = std::to_string(maxTokens - cost);
                 uint64_t newRev;
                 s = g_natsLoader.kvStore_UpdateString(&newRev, kv, fullKey.c_str(), newValue.c_str(), rev);
                 return s == NATS_OK;
@@ -191,13 +191,13 @@ public:
             return false;
         }
         
-        // Check if we have tokens available (try to acquire 1 token)
-        if (currentTokens <= 0) {
+        // Check if we have cost tokens available
+        if (currentTokens < cost) {
             return false;
         }
         
         // Try to atomically decrement
-        std::string newValue = std::to_string(currentTokens - 1);
+        std::string newValue = std::to_string(currentTokens - cost);
         uint64_t newRev;
         s = g_natsLoader.kvStore_UpdateString(&newRev, kv, fullKey.c_str(), newValue.c_str(), revision);
         
@@ -211,39 +211,44 @@ public:
         std::string sanitizedKey = prefix + key;
         std::replace(sanitizedKey.begin(), sanitizedKey.end(), ':', '_');
         const std::string fullKey = sanitizedKey;
-        kvEntry* entry = nullptr;
-        natsStatus s;
-        
-        // Get current value
-        s = g_natsLoader.kvStore_Get(&entry, kv, fullKey.c_str());
-        if (s != NATS_OK) {
-            if (entry) g_natsLoader.kvEntry_Destroy(entry);
-            return;
-        }
-        
-        // Parse current token count
-        const char* data = (const char*)g_natsLoader.kvEntry_Value(entry);
-        if (!data) {
+
+        // The update is conditional on the revision read; retry a few times
+        // when another instance wrote in between, so debits are not lost
+        for (int attempt = 0; attempt < 8; attempt++) {
+            kvEntry* entry = nullptr;
+            natsStatus s = g_natsLoader.kvStore_Get(&entry, kv, fullKey.c_str());
+            if (s != NATS_OK) {
+                if (entry) g_natsLoader.kvEntry_Destroy(entry);
+                return;
+            }
+
+            // Parse current token count
+            const char* data = (const char*)g_natsLoader.kvEntry_Value(entry);
+            if (!data) {
+                g_natsLoader.kvEntry_Destroy(entry);
+                return;
+            }
+
+            int dataLen = g_natsLoader.kvEntry_ValueLen(entry);
+            std::string valueStr(data, dataLen);
+            uint64_t revision = g_natsLoader.kvEntry_Revision(entry);
             g_natsLoader.kvEntry_Destroy(entry);
-            return;
-        }
-        
-        int dataLen = g_natsLoader.kvEntry_ValueLen(entry);
-        std::string valueStr(data, dataLen);
-        uint64_t revision = g_natsLoader.kvEntry_Revision(entry);
-        g_natsLoader.kvEntry_Destroy(entry);
-        
-        int64_t currentTokens;
-        try {
-            currentTokens = std::stoll(valueStr);
-        } catch (...) {
-            return;
+
+            int64_t currentTokens;
+            try {
+                currentTokens = std::stoll(valueStr);
+            } catch (...) {
+                return;
+            }
+
+            // Add tokens back (or take them, for a negative charge)
+            std::string newValue = std::to_string(currentTokens + tokens);
+            uint64_t newRev;
+            if (g_natsLoader.kvStore_UpdateString(&newRev, kv, fullKey.c_str(), newValue.c_str(),
+                                                  revision) == NATS_OK) {
+                return;
+            }
         }
-        
-        // Add tokens back
-        std::string newValue = std::to_string(currentTokens + tokens);
-        uint64_t newRev;
-        g_natsLoader.kvStore_UpdateString(&newRev, kv, fullKey.c_str(), newValue.c_str(), revision);
     }
     
     void reset(const std::string& key, int64_t maxTokens) override {
@@ -253,10 +258,41 @@ public:
         std::string sanitizedKey = prefix + key;
         std::replace(sanitizedKey.begin(), sanitizedKey.end(), ':', '_');
         const std::string fullKey = sanitizedKey;
-        
-        // Set the value to maxTokens regardless of current value
-        std::string value = std::to_string(maxTokens);
-        uint64_t rev;
-        g_natsLoader.kvStore_Put(&rev, kv, fullKey.c_str(), value.c_str(), value.length());
+
+        // Debt charged in the old window is repaid out of the new one, so
+        // the update is conditional on the revision read, as in release()
+        for (int attempt = 0; attempt < 8; attempt++) {
+            kvEntry* entry = nullptr;
+            natsStatus s = g_natsLoader.kvStore_Get(&entry, kv, fullKey.c_str());
+            if (s == NATS_NOT_FOUND) {
+                std::string value = std::to_string(maxTokens);
+                uint64_t rev;
+                g_natsLoader.kvStore_Put(&rev, kv, fullKey.c_str(), value.c_str(), value.length());
+                return;
+            }
+            if (s != NATS_OK) {
+                if (entry) g_natsLoader.kvEntry_Destroy(entry);
+                return;
+            }
+
+            const char* data = (const char*)g_natsLoader.kvEntry_Value(entry);
+            std::string valueStr = data ? std::string(data, g_natsLoader.kvEntry_ValueLen(entry)) : "";
+            uint64_t revision = g_natsLoader.kvEntry_Revision(entry);
+            g_natsLoader.kvEntry_Destroy(entry);
+
+            int64_t currentTokens = 0;
+            try {
+                currentTokens = std::stoll(valueStr);
+            } catch (...) {
+                // Not a count; start the window afresh
+            }
+
+            std::string newValue = std::to_string(maxTokens + std::min(int64_t(0), currentTokens));
+            uint64_t newRev;
+            if (g_natsLoader.kvStore_UpdateString(&newRev, kv, fullKey.c_str(), newValue.c_str(),
+                                                  revision) == NATS_OK) {
+                return;
+            }
+        }
     }
 };
\ No newline at end of file
@@ -5,14 +5,24 @@
 #endif
 
 #include <atomic>
+#include <limits>
 #include <chrono>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <array>
 #include <functional>
 #include <stdexcept>
 #include <cmath>
-#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "clock.hpp"
+#include "events.hpp"
 
 // MurmurHash3_32 implementation
 inline uint32_t rotl32(uint32_t x, int8_t r) noexcept {
@@ -32,17 +42,280 @@ inline uint32_t fmix32(uint32_t h) noexcept {
 class DistributedStorage {
 public:
     virtual ~DistributedStorage() = default;
-    virtual bool tryAcquire(const std::string& key, int64_t tokens) = 0;
+    // Take cost tokens from key's shared bucket, creating it with maxTokens
+    // if it does not exist yet; false if fewer than cost are left
+    virtual bool tryAcquire(const std::string& key, int64_t maxTokens, int64_t cost) = 0;
+    // Add tokens to key's shared bucket; a negative amount debits it and may
+    // leave it below zero (charge() after a costly request)
     virtual void release(const std::string& key, int64_t tokens) = 0;
+    // Start a new fixed window: refill key's shared bucket to maxTokens,
+    // less any debt it is in, which the new window repays
     virtual void reset(const std::string& key, int64_t maxTokens) = 0;
 };
 
+// A limiter's storage connections. Clients are not thread-safe, so every
+// call leases a connection of its own: calls from several threads each
+// wait on their own round trip instead of queueing behind one connection.
+class StoragePool {
+public:
+    using Connections = std::vector<std::unique_ptr<DistributedStorage>>;
+
+    // Returns its connection to the pool when it goes out of scope
+    class Lease {
+    public:
+        Lease(StoragePool& pool, DistributedStorage* storage) noexcept : pool(pool), storage(storage) {}
+
+        ~Lease() {
+            pool.giveBack(storage);
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        DistributedStorage* operator->() const noexcept {
+            return storage;
+        }
+
+    private:
+        StoragePool& pool;
+        DistributedStorage* storage;
+    };
+
+    explicit StoragePool(Connections connections) : connections(std::move(connections)) {
+        for (auto& connection : this->connections) idle.push_back(connection.get());
+    }
+
+    // Waits while every connection is in use
+    Lease lease() {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this] { return !idle.empty(); });
+        DistributedStorage* storage = idle.back();
+        idle.pop_back();
+        return Lease(*this, storage);
+    }
+
+    size_t size() const noexcept {
+        return connections.size();
+    }
+
+private:
+    void giveBack(DistributedStorage* storage) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(storage);
+        }
+        available.notify_one();
+    }
+
+    const Connections connections;
+    std::vector<DistributedStorage*> idle;
+    std::mutex mutex;
+    std::condition_variable available;
+};
+
+// Compile-time feature policy for the request path. Each limiter is tagged with
+// the features it uses and tryRequest dispatches once to the matching
+// instantiation, so a plain local token bucket never evaluates the branches
+// for sliding refill, distributed sync, blocking, penalties or striping.
+enum PolicyBits : uint8_t {
+    kSliding     = 1 << 0,
+    kDistributed = 1 << 1,
+    kBlock       = 1 << 2,
+    kPenalty     = 1 << 3,
+    kStriped     = 1 << 4,
+    kPolicyCount = 1 << 5
+};
+
+template <bool Sliding, bool Distributed, bool Block, bool Penalty, bool Striped>
+struct Features {
+    static constexpr bool sliding = Sliding;
+    static constexpr bool distributed = Distributed;
+    static constexpr bool block = Block;
+    static constexpr bool penalty = Penalty;
+    static constexpr bool striped = Striped;
+};
+
+template <uint8_t P>
+using FeaturesFor = Features<(P & kSliding) != 0, (P & kDistributed) != 0,
+                             (P & kBlock) != 0, (P & kPenalty) != 0, (P & kStriped) != 0>;
+
+// Wait-free consume: unconditionally take cost tokens and, only if that
+// overdrew the bucket below floor, give them back and report a rejection. The
+// allow path is a single fetch_sub instead of a CAS retry loop that degrades
+// under contention. A rejected caller leaves the bucket overdrawn by at most
+// cost until its correction lands, so a concurrent reader may see a briefly
+// negative count but can never be admitted on tokens that were not there.
+// An exhausted bucket is rejected on a plain load so the reject path stays
+// read-only and keeps the cache line shared.
+//
+// cap is the limit refills clamp the bucket to. A refill landing while the
+// bucket is overdrawn clamps the overdrawn count, so the correction must not
+// lift the bucket past cap (or past what it held before, if that was more).
+inline bool tryTakeTokens(std::atomic<int64_t>& tokens, int64_t cost, int64_t floor = 0,
+                          int64_t cap = std::numeric_limits<int64_t>::max()) noexcept {
+    if (tokens.load(std::memory_order_relaxed) - cost < floor) return false;
+    int64_t previous = tokens.fetch_sub(cost, std::memory_order_acq_rel);
+    if (previous - cost >= floor) return true;
+
+    const int64_t ceiling = std::max(cap, previous);
+    int64_t current = previous - cost;
+    while (!tokens.compare_exchange_weak(current, std::min(current + cost, ceiling),
+                                         std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+    return false;
+}
+
+// Striped mode for very hot keys: tokens are handed out to per-thread stripes
+// on separate cache lines in batches, so concurrent consumers only contend on
+// the shared bucket when their stripe runs dry. At most stripes * batch tokens
+// are held locally at any time, which bounds the deviation from the exact limit.
+struct alignas(64) Stripe {
+    std::atomic<int64_t> tokens{0};
+};
+
+// Small per-thread index used to pick a stripe or metrics shard
+inline size_t threadSlot() noexcept {
+    static std::atomic<size_t> nextThread{0};
+    thread_local size_t slot = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+struct StripeSet {
+    const size_t count;   // Power of two
+    const int64_t batch;  // Tokens moved from the shared bucket per exhaustion
+    std::unique_ptr<Stripe[]> slots;
+
+    StripeSet(size_t n, int64_t b) : count(n), batch(b), slots(new Stripe[n]) {}
+
+    Stripe& local(size_t slot) noexcept {
+        return slots[slot & (count - 1)];
+    }
+
+    int64_t held() const noexcept {
+        int64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += std::max(int64_t(0), slots[i].tokens.load(std::memory_order_relaxed));
+        }
+        return total;
+    }
+
+    void drain() noexcept {
+        for (size_t i = 0; i < count; i++) {
+            slots[i].tokens.store(0, std::memory_order_release);
+        }
+    }
+};
+
+// Deferred freeing of memory that lookups on other threads may still be
+// using: limiters replaced or dropped from the table, tables replaced by a
+// rehash and stripe sets replaced by setStriping. A reader pins the current
+// generation for the length of one call. Retired memory is freed once every
+// reader of the generation it was retired in has left, which poll() checks
+// without ever waiting for one, so no writer blocks behind a request.
+//
+// Readers load the pointers they follow with seq_cst after pinning. Paired
+// with the fence in drained(), either the writer sees the pin or the reader
+// sees the pointer already unlinked.
+class Reclaimer {
+public:
+    class Pin {
+    public:
+        explicit Pin(Reclaimer& reclaimer) noexcept : readers(reclaimer.enter()) {}
+        ~Pin() {
+            readers->fetch_sub(1, std::memory_order_release);
+        }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+
+    private:
+        std::atomic<int64_t>* readers;
+    };
+
+    Reclaimer() = default;
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+
+    ~Reclaimer() {
+        freeAll(waiting);
+        freeAll(pending);
+    }
+
+    // Free object once no reader can reach it; it must already be unlinked.
+    // Callers serialize retire() and poll().
+    template <typename T>
+    void retire(T* object) {
+        if (object) pending.push_back({object, [](void* p) { delete static_cast<T*>(p); }});
+    }
+
+    void poll() {
+        if (!waiting.empty()) {
+            if (!drained(waitingGeneration)) return;
+            freeAll(waiting);
+        }
+        if (pending.empty()) return;
+        // New readers pin the other generation, so this one drains even
+        // under a steady stream of requests
+        waiting.swap(pending);
+        waitingGeneration = generation.load(std::memory_order_relaxed);
+        generation.store(waitingGeneration ^ 1, std::memory_order_seq_cst);
+        if (drained(waitingGeneration)) freeAll(waiting);
+    }
+
+private:
+    struct Retired {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    struct alignas(64) Shard {
+        std::atomic<int64_t> readers[2]{};
+    };
+    static constexpr size_t kShards = 16;
+
+    std::atomic<int64_t>* enter() noexcept {
+        Shard& shard = shards[threadSlot() & (kShards - 1)];
+        std::atomic<int64_t>* readers = &shard.readers[generation.load(std::memory_order_acquire)];
+        readers->fetch_add(1, std::memory_order_seq_cst);
+        return readers;
+    }
+
+    bool drained(uint32_t g) const noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const Shard& shard : shards) {
+            if (shard.readers[g].load(std::memory_order_acquire) != 0) return false;
+        }
+        return true;
+    }
+
+    static void freeAll(std::vector<Retired>& list) noexcept {
+        for (const Retired& retired : list) retired.destroy(retired.object);
+        list.clear();
+    }
+
+    std::array<Shard, kShards> shards;
+    std::atomic<uint32_t> generation{0};
+    uint32_t waitingGeneration = 0;
+    std::vector<Retired> pending;  // Retired since the last generation flip
+    std::vector<Retired> waiting;  // Waiting for waitingGeneration to drain
+};
+
 class RateLimiter {
 private:
-    std::atomic<size_t> BUCKET_COUNT;
-    std::atomic<size_t> BUCKET_MASK;
-    std::atomic<bool> isResizing{false};
-    
+    // Eviction state of a limiter. Only limiters made by ensureLimiter can be
+    // evicted; everything created explicitly stays pinned.
+    enum IdleState : uint8_t {
+        kPinned,    // Never evicted
+        kActive,    // Evictable, in use
+        kIdle,      // Evictable, found idle at idleSince
+        kEvicting   // Claimed by the sweep
+    };
+
+    // Timestamps and durations are in ticks of the limiter's clock:
+    // milliseconds unless a finer ClockResolution was configured.
+    //
+    // A limiter's key and settings never change once it is in the table:
+    // reconfiguring one puts a new entry in its place. Lookups on other
+    // threads can therefore compare keys and read settings without locks.
     struct alignas(64) Entry {
         // Hot path members - 64-byte cache line #1
         std::atomic<int64_t> tokens;           // 8 bytes
@@ -51,86 +324,63 @@ private:
         std::atomic<int64_t> dynamicMaxTokens; // 8 bytes
         std::atomic<int64_t> penaltyPoints;    // 8 bytes
         std::atomic<bool> valid;               // 1 byte + padding
-        bool isSlidingWindow;                  // 1 byte
-        // 14 bytes padding to align to cache line
+        const bool isSlidingWindow;            // 1 byte
+        std::atomic<uint8_t> policy;           // 1 byte, PolicyBits
+        std::atomic<uint8_t> idleState;        // 1 byte, IdleState
+        std::atomic<uint32_t> idleSince;       // 4 bytes, clock ms when maintenance found it idle
+        std::atomic<StripeSet*> stripes;       // 8 bytes, only set in striped mode
 
-        // Cold path members - 64-byte cache line #2
+        // Cold path members - baseMaxTokens closes cache line #1, the rest
+        // and the keys take line #2 and the start of line #3
         const int64_t baseMaxTokens;           // 8 bytes
-        const int64_t refillTimeMs;            // 8 bytes
-        const int64_t blockDurationMs;         // 8 bytes
+        const int64_t refillTime;              // 8 bytes
+        const int64_t blockDuration;           // 8 bytes
         const int64_t maxPenaltyPoints;        // 8 bytes
-        std::string key;                       // 24 bytes (typical)
-        std::string distributedKey;            // 24 bytes (typical)
-
-        Entry() noexcept : 
-            tokens(0),
-            lastRefill(0),
-            blockUntil(0),
-            dynamicMaxTokens(0),
-            penaltyPoints(0),
-            valid(false),
-            isSlidingWindow(false),
-            baseMaxTokens(0),
-            refillTimeMs(0),
-            blockDurationMs(0),
-            maxPenaltyPoints(0),
-            key(),
-            distributedKey() {}
-        
+        const std::string key;                 // 32 bytes with libstdc++
+        const std::string distributedKey;      // 32 bytes with libstdc++
+
+        // Fair-share accounting - the rest of line #3 and line #4, for 256
+        // bytes in all; only touched by tryRequestFairShare
+        std::atomic<int64_t> shareEpoch;       // Window the counters below belong to
+        std::atomic<int64_t> shareUsed;        // Tokens consumed in that window
+        std::atomic<int64_t> weight;           // Tenant weight
+        std::atomic<int64_t> activeWeight;     // Pool: sum of active tenant weights, tagged with its window
+        std::atomic<int64_t> prevActiveWeight; // Pool: active weight of the window before that
+        std::atomic<bool> hasTenants;          // Pool: tenants were created under its key
+
         Entry(const std::string& k, int64_t max, int64_t refill, bool sliding = false,
-              int64_t blockMs = 0, int64_t maxPenalty = 0, const std::string& distKey = "")
+              int64_t blockTicks = 0, int64_t maxPenalty = 0, const std::string& distKey = "",
+              int64_t now = 0)
             : tokens(max),
-              lastRefill(getCurrentTimeMs()),
+              lastRefill(now),
               blockUntil(0),
               dynamicMaxTokens(max),
               penaltyPoints(0),
               valid(true),
               isSlidingWindow(sliding),
+              policy((sliding ? kSliding : 0) | (!distKey.empty() ? kDistributed : 0) |
+                     (blockTicks > 0 ? kBlock : 0) | (maxPenalty > 0 ? kPenalty : 0)),
+              idleState(kPinned),
+              idleSince(0),
+              stripes(nullptr),
               baseMaxTokens(max),
-              refillTimeMs(refill),
-              blockDurationMs(blockMs),
+              refillTime(refill),
+              blockDuration(blockTicks),
               maxPenaltyPoints(maxPenalty),
               key(k),
-              distributedKey(distKey) {}
+              distributedKey(distKey),
+              shareEpoch(-1),
+              shareUsed(0),
+              weight(1),
+              activeWeight(0),
+              prevActiveWeight(0),
+              hasTenants(false) {}
 
         Entry(const Entry&) = delete;
         Entry& operator=(const Entry&) = delete;
 
-        Entry(Entry&& other) noexcept
-            : tokens(other.tokens.load(std::memory_order_relaxed)),
-              lastRefill(other.lastRefill.load(std::memory_order_relaxed)),
-              blockUntil(other.blockUntil.load(std::memory_order_relaxed)),
-              dynamicMaxTokens(other.dynamicMaxTokens.load(std::memory_order_relaxed)),
-              penaltyPoints(other.penaltyPoints.load(std::memory_order_relaxed)),
-              valid(other.valid.load(std::memory_order_relaxed)),
-              isSlidingWindow(other.isSlidingWindow),
-              baseMaxTokens(other.baseMaxTokens),
-              refillTimeMs(other.refillTimeMs),
-              blockDurationMs(other.blockDurationMs),
-              maxPenaltyPoints(other.maxPenaltyPoints),
-              key(std::move(other.key)),
-              distributedKey(std::move(other.distributedKey)) {
-            other.valid.store(false, std::memory_order_relaxed);
-        }
-
-        Entry& operator=(Entry&& other) noexcept {
-            if (this != &other) {
-                tokens.store(other.tokens.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                lastRefill.store(other.lastRefill.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                valid.store(other.valid.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                blockUntil.store(other.blockUntil.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                dynamicMaxTokens.store(other.dynamicMaxTokens.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                penaltyPoints.store(other.penaltyPoints.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                const_cast<int64_t&>(baseMaxTokens) = other.baseMaxTokens;
-                const_cast<int64_t&>(refillTimeMs) = other.refillTimeMs;
-                const_cast<bool&>(isSlidingWindow) = other.isSlidingWindow;
-                const_cast<int64_t&>(blockDurationMs) = other.blockDurationMs;
-                const_cast<int64_t&>(maxPenaltyPoints) = other.maxPenaltyPoints;
-                key = std::move(other.key);
-                distributedKey = std::move(other.distributedKey);
-                other.valid.store(false, std::memory_order_relaxed);
-            }
-            return *this;
+        ~Entry() {
+            delete stripes.load(std::memory_order_relaxed);
         }
 
         // Calculate dynamic rate limit based on penalty points
@@ -160,16 +410,109 @@ private:
         }
     };
 
-    std::unique_ptr<DistributedStorage> distributedStorage;
-    Entry* entries;
-    std::atomic<Entry*> entriesPtr;
-    std::atomic<size_t> entryCount{0};
+    // The table holds pointers, so a limiter keeps its address for its
+    // whole life: a rehash moves pointers, never state that requests on
+    // other threads may be updating. The hash is kept next to the pointer,
+    // so a probe only follows pointers to likely matches. A null slot ends a
+    // probe chain; a slot whose entry is no longer valid is a tombstone.
+    struct Slot {
+        std::atomic<Entry*> entry{nullptr};
+        std::atomic<uint32_t> hash{0};
+    };
+
+    struct Table {
+        const size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        explicit Table(size_t size) : mask(size - 1), slots(new Slot[size]) {}
+
+        size_t size() const noexcept {
+            return mask + 1;
+        }
+    };
+
+    // Null without distributed storage
+    std::unique_ptr<StoragePool> distributedStorage;
+    // Limiters only take the distributed path when storage is configured
+    const uint8_t policyMask;
+    // Time source for every decision; see ClockSource
+    Clock clock;
+    // Serializes table layout changes (insert, resize, striping) with the
+    // maintenance sweep; the request path never takes it
+    std::mutex structureMutex;
+    size_t sweepCursor = 0;  // Next slot to sweep, guarded by structureMutex
+    std::thread maintenanceThread;
+    std::mutex maintenanceMutex;
+    std::condition_variable maintenanceWake;
+    bool maintenanceStop = false;
+    std::atomic<Table*> table;
+    size_t entryCount = 0;      // Live limiters, guarded by structureMutex
+    size_t tombstoneCount = 0;  // Guarded by structureMutex
+    // Frees limiters, tables and stripe sets once lookups on other threads
+    // are done with them. Retiring and polling are guarded by structureMutex.
+    Reclaimer reclaimer;
+
+    // One event ring per subscriber, so threads sharing the limiter each
+    // see every event. A slot's ring is created by its first subscriber and
+    // kept until the limiter is destroyed, so a request thread never pushes
+    // into freed memory; later subscribers of the slot reuse it.
+    // eventSubscribers has a bit per slot in use and is zero while nobody
+    // subscribes, which is all the decision path checks.
+    static constexpr size_t kMaxEventSubscribers = 32;
+    std::unique_ptr<EventRing> eventRings[kMaxEventSubscribers];
+    std::atomic<uint32_t> eventSubscribers{0};
+
+    void emit(LimiterEvent type, const Entry& entry, int64_t time, int64_t value) noexcept {
+        uint32_t subscribers = eventSubscribers.load(std::memory_order_acquire);
+        if (!subscribers || entry.key.empty()) return;
+        do {
+            eventRings[__builtin_ctz(subscribers)]->push(type, entry.key, time, value);
+            subscribers &= subscribers - 1;
+        } while (subscribers);
+    }
+
+    // A request found an expired block: clear it once and report it
+    void unblockExpired(Entry& entry, int64_t blockedUntil, int64_t now) noexcept {
+        if (entry.blockUntil.compare_exchange_strong(blockedUntil, 0, std::memory_order_acq_rel)) {
+            emit(LimiterEvent::Unblock, entry, now, 0);
+        }
+    }
+
+    // Integer ids for limiters the caller addresses often, so a request skips
+    // hashing and key comparison. An id packs a registry index (low 20 bits)
+    // with that index's generation (next 10 bits); removing a limiter bumps
+    // the generation, so a stale id stops matching once its index is reused.
+    // Ids stay below 2^30 and fit a V8 small integer. The registry maps each
+    // live id to the limiter's entry and reconfiguration keeps it current;
+    // entries themselves carry no id, so they keep their cache-line layout.
+    static constexpr uint32_t kIdIndexBits = 20;
+    static constexpr uint32_t kIdIndexMask = (1u << kIdIndexBits) - 1;
+    static constexpr uint32_t kIdGenerationMask = (1u << 10) - 1;
+    static constexpr size_t kIdPageSize = 4096;
+
+    struct IdSlot {
+        std::atomic<uint32_t> id{0};          // Current id of this index, 0 while free
+        std::atomic<Entry*> entry{nullptr};   // The limiter's table entry
+    };
+
+    // Pages are allocated once and never move, so lookups need no lock.
+    // Everything else below is guarded by structureMutex.
+    std::unique_ptr<IdSlot[]> idPages[(kIdIndexMask + 1) / kIdPageSize];
+    std::unordered_map<std::string, uint32_t> idsByKey;
+    uint32_t nextIdIndex = 1;       // Index 0 is never issued, so 0 means "no id"
+    std::vector<uint32_t> freeIds;  // Next id to issue for each released index
 
     static constexpr size_t nextPowerOf2(size_t v) noexcept {
         return v == 0 ? 1 : size_t(1) << (sizeof(size_t) * 8 - __builtin_clzll(v - 1));
     }
 
-    static size_t murmur3_32(const std::string& key) noexcept {
+    static StoragePool::Connections single(DistributedStorage* storage) {
+        StoragePool::Connections connections;
+        if (storage) connections.emplace_back(storage);
+        return connections;
+    }
+
+    static size_t murmur3_32(std::string_view key) noexcept {
         const uint32_t seed = 0x12345678;
         const uint32_t c1 = 0xcc9e2d51;
         const uint32_t c2 = 0x1b873593;
@@ -224,14 +567,36 @@ private:
         return static_cast<size_t>(h1);
     }
 
-    static int64_t getCurrentTimeMs() noexcept {
-        return std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()
-        ).count();
+    // Invoke fn with the Features instantiation matching a limiter's policy.
+    // The policy is read once, as setStriping on another thread may change
+    // it mid-dispatch. Policy 0 (plain local bucket) is tested first.
+    template <typename Fn>
+    decltype(auto) withPolicy(const Entry& entry, Fn&& fn) noexcept {
+        return dispatchPolicy<0>(static_cast<uint8_t>(entry.policy.load(std::memory_order_acquire) & policyMask),
+                                 std::forward<Fn>(fn));
+    }
+
+    template <uint8_t P, typename Fn>
+    static decltype(auto) dispatchPolicy(uint8_t policy, Fn&& fn) noexcept {
+        if constexpr (P + 1 < kPolicyCount) {
+            if (policy != P) {
+                return dispatchPolicy<P + 1>(policy, std::forward<Fn>(fn));
+            }
+        }
+        return fn(FeaturesFor<P>{});
     }
 
     void refillTokens(Entry& entry) noexcept {
-        int64_t now = getCurrentTimeMs();
+        refillTokens(entry, clock.now());
+    }
+
+    void refillTokens(Entry& entry, int64_t now) noexcept {
+        withPolicy(entry, [&](auto features) { refillTokens<decltype(features)>(entry, now); });
+    }
+
+    // now is read once per decision by the caller and passed through
+    template <typename F>
+    void refillTokens(Entry& entry, int64_t now) noexcept {
         int64_t lastRefill;
         int64_t currentTokens;
         int64_t dynamicLimit;
@@ -240,30 +605,55 @@ private:
             lastRefill = entry.lastRefill.load(std::memory_order_acquire);
             int64_t timePassed = now - lastRefill;
 
-            if (timePassed < entry.refillTimeMs && !entry.isSlidingWindow) {
+            if (!F::sliding && timePassed < entry.refillTime) {
                 return;
             }
 
             // Calculate dynamic limit first to ensure consistency
-            dynamicLimit = entry.calculateDynamicLimit();
+            dynamicLimit = F::penalty ? entry.calculateDynamicLimit() : entry.baseMaxTokens;
             currentTokens = entry.tokens.load(std::memory_order_acquire);
 
             // For sliding window, calculate exact token amount without floating point
-            if (entry.isSlidingWindow) {
+            if constexpr (F::sliding) {
+                // Time beyond what it takes to fill the bucket adds nothing;
+                // capping here also keeps the product below from overflowing
+                // for byte-sized limits
+                int64_t elapsed = 0;
+                if (currentTokens < dynamicLimit) {
+                    int64_t timeToFull = ((dynamicLimit - currentTokens) * entry.refillTime +
+                        dynamicLimit - 1) / dynamicLimit;
+                    elapsed = std::min(timePassed, timeToFull);
+                }
                 // Use integer arithmetic to avoid floating point errors
-                int64_t tokensToAdd = (dynamicLimit * timePassed) / entry.refillTimeMs;
-                int64_t newTokens = std::min(currentTokens + tokensToAdd, dynamicLimit);
-                
-                if (entry.lastRefill.compare_exchange_strong(lastRefill, now,
+                int64_t tokensToAdd = (dynamicLimit * elapsed) / entry.refillTime;
+                if (tokensToAdd <= 0 && currentTokens < dynamicLimit) {
+                    // Leave lastRefill alone so the partial token keeps accruing
+                    return;
+                }
+
+                // Only advance lastRefill by the time the added tokens account
+                // for, so frequent refills do not drop the remainder each time
+                int64_t refilledAt = now;
+                if (currentTokens + tokensToAdd < dynamicLimit) {
+                    refilledAt = lastRefill +
+                        (tokensToAdd * entry.refillTime + dynamicLimit - 1) / dynamicLimit;
+                }
+
+                if (entry.lastRefill.compare_exchange_strong(lastRefill, refilledAt,
                     std::memory_order_acq_rel, std::memory_order_acquire)) {
                     entry.dynamicMaxTokens.store(dynamicLimit, std::memory_order_release);
-                    entry.tokens.store(newTokens, std::memory_order_release);
+                    // Add rather than store so tokens taken since the load are kept
+                    int64_t tokens = entry.tokens.load(std::memory_order_acquire);
+                    while (!entry.tokens.compare_exchange_weak(tokens,
+                            std::min(tokens + tokensToAdd, dynamicLimit),
+                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    }
                     
                     // Sync sliding window refill with distributed storage
-                    if (distributedStorage && !entry.distributedKey.empty() && tokensToAdd > 0) {
+                    if (F::distributed && tokensToAdd > 0) {
                         try {
                             // Release tokens back to distributed storage (effectively adding them)
-                            distributedStorage->release(entry.distributedKey, tokensToAdd);
+                            distributedStorage->lease()->release(entry.distributedKey, tokensToAdd);
                         } catch (...) {
                             // Ignore errors - distributed storage might be temporarily unavailable
                         }
@@ -272,16 +662,26 @@ private:
                     return;
                 }
             } else {
-                // For fixed window, just reset to dynamic limit
+                // For fixed window, reset to dynamic limit; outstanding debt
+                // from charge() is repaid out of the new window
                 if (entry.lastRefill.compare_exchange_strong(lastRefill, now,
                     std::memory_order_acq_rel, std::memory_order_acquire)) {
                     entry.dynamicMaxTokens.store(dynamicLimit, std::memory_order_release);
-                    entry.tokens.store(dynamicLimit, std::memory_order_release);
+                    int64_t tokens = entry.tokens.load(std::memory_order_acquire);
+                    while (!entry.tokens.compare_exchange_weak(tokens,
+                            dynamicLimit + std::min(int64_t(0), tokens),
+                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    }
+                    if constexpr (F::striped) {
+                        // Tokens parked in stripes belong to the previous window
+                        if (StripeSet* set = entry.stripes.load(std::memory_order_seq_cst)) set->drain();
+                    }
                     
-                    // Reset distributed storage for fixed window
-                    if (distributedStorage && !entry.distributedKey.empty()) {
+                    // Reset distributed storage for fixed window; storage
+                    // keeps the shared debt the same way
+                    if (F::distributed) {
                         try {
-                            distributedStorage->reset(entry.distributedKey, dynamicLimit);
+                            distributedStorage->lease()->reset(entry.distributedKey, dynamicLimit);
                         } catch (...) {
                             // Ignore errors - distributed storage might be temporarily unavailable
                         }
@@ -297,74 +697,324 @@ private:
         int64_t blockedUntil = entry.blockUntil.load(std::memory_order_acquire);
         if (blockedUntil == 0) return false;
         
-        int64_t now = getCurrentTimeMs();
+        int64_t now = clock.now();
         if (now >= blockedUntil) {
-            entry.blockUntil.store(0, std::memory_order_release);
+            unblockExpired(entry, blockedUntil, now);
             return false;
         }
         return true;
     }
 
-    Entry* findEntry(const std::string& key) noexcept {
+    // Open addressing with linear probing over Slots. Callers hold a
+    // Reclaimer::Pin or structureMutex, so nothing they reach is freed.
+    Entry* findEntry(std::string_view key) noexcept {
         if (key.empty()) return nullptr;
         
-        const size_t h = murmur3_32(key);
-        size_t idx = h & BUCKET_MASK.load(std::memory_order_relaxed);
-        size_t probes = 0;
-        
-        // Use prefetch to reduce cache misses
-        __builtin_prefetch(&entriesPtr.load(std::memory_order_relaxed)[idx], 0, 0);
-        
-        // Unroll the loop for better performance
-        while (probes < BUCKET_COUNT.load(std::memory_order_relaxed)) {
-            Entry& entry = entriesPtr.load(std::memory_order_relaxed)[idx];
-            bool isValid = entry.valid.load(std::memory_order_relaxed);
-            if (!isValid) return nullptr;
-            if (entry.key == key) return &entry;
-            
-            idx = (idx + 1) & BUCKET_MASK.load(std::memory_order_relaxed);
-            probes++;
+        const Table& t = *table.load(std::memory_order_seq_cst);
+        const uint32_t hash = static_cast<uint32_t>(murmur3_32(key));
+        return probe(t, hash & t.mask, hash, key);
+    }
+
+    // Walk the probe chain of key starting at its home slot idx
+    static Entry* probe(const Table& t, size_t idx, uint32_t hash, std::string_view key) noexcept {
+        for (size_t probes = 0; probes <= t.mask; probes++) {
+            const Slot& slot = t.slots[idx];
+            Entry* entry = slot.entry.load(std::memory_order_seq_cst);
+            if (!entry) return nullptr;
+            if (slot.hash.load(std::memory_order_relaxed) == hash &&
+                entry->valid.load(std::memory_order_acquire) && entry->key == key) {
+                return entry;
+            }
             
-            // Prefetch next entry
-            __builtin_prefetch(&entriesPtr.load(std::memory_order_relaxed)[idx], 0, 0);
+            idx = (idx + 1) & t.mask;
             
-            // Early exit if we've probed too far
-            if (probes > 8) {  // Most collisions are resolved within 8 probes
-                size_t jumpSize = (h >> 16) | 1;  // Use high bits for jump size
-                idx = (idx + jumpSize) & BUCKET_MASK.load(std::memory_order_relaxed);
-            }
+            // Prefetch next slot
+            __builtin_prefetch(&t.slots[idx], 0, 0);
         }
         return nullptr;
     }
 
-    void resize() noexcept {
-        if (isResizing.exchange(true)) return;
-        
-        size_t oldSize = BUCKET_COUNT.load(std::memory_order_relaxed);
-        size_t newSize = oldSize * 2;
-        Entry* newEntries = new Entry[newSize];
-        
-        // Rehash existing entries
-        Entry* oldEntries = entriesPtr.load(std::memory_order_relaxed);
-        for (size_t i = 0; i < oldSize; i++) {
-            Entry& entry = oldEntries[i];
-            if (!entry.valid.load(std::memory_order_relaxed)) continue;
-            
-            const size_t h = murmur3_32(entry.key);
-            size_t idx = h & (newSize - 1);
-            
-            while (newEntries[idx].valid.load(std::memory_order_relaxed)) {
-                idx = (idx + 1) & (newSize - 1);
+    IdSlot& idSlot(uint32_t id) noexcept {
+        const uint32_t index = id & kIdIndexMask;
+        return idPages[index / kIdPageSize][index % kIdPageSize];
+    }
+
+    uint32_t idOf(const std::string& key) const noexcept {
+        auto it = idsByKey.find(key);
+        return it != idsByKey.end() ? it->second : 0;
+    }
+
+    // Give the limiter at entry an id, or return the one it has.
+    // Called with structureMutex held.
+    uint32_t assignId(const std::string& key, Entry* entry) {
+        if (uint32_t id = idOf(key)) return id;
+
+        uint32_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            if (nextIdIndex > kIdIndexMask) {
+                throw std::length_error("Too many limiter ids");
+            }
+            id = nextIdIndex++;
+            auto& page = idPages[id / kIdPageSize];
+            if (!page) page = std::make_unique<IdSlot[]>(kIdPageSize);
+        }
+        IdSlot& s = idSlot(id);
+        s.entry.store(entry, std::memory_order_relaxed);
+        s.id.store(id, std::memory_order_release);
+        idsByKey.emplace(key, id);
+        return id;
+    }
+
+    // Retire the id of a limiter leaving the table. Called with
+    // structureMutex held.
+    void releaseId(const std::string& key) {
+        auto it = idsByKey.find(key);
+        if (it == idsByKey.end()) return;
+        const uint32_t id = it->second;
+        idsByKey.erase(it);
+        idSlot(id).id.store(0, std::memory_order_release);
+        const uint32_t generation = ((id >> kIdIndexBits) + 1) & kIdGenerationMask;
+        freeIds.push_back((generation << kIdIndexBits) | (id & kIdIndexMask));
+    }
+
+    Entry* findEntryById(uint32_t id) noexcept {
+        const uint32_t index = id & kIdIndexMask;
+        if (index == 0 || id >> kIdIndexBits > kIdGenerationMask) return nullptr;
+        IdSlot* page = idPages[index / kIdPageSize].get();
+        if (!page) return nullptr;
+
+        IdSlot& s = page[index % kIdPageSize];
+        if (s.id.load(std::memory_order_seq_cst) != id) return nullptr;
+        return s.entry.load(std::memory_order_seq_cst);
+    }
+
+    // Rebuild the table at size without its tombstones. Called with
+    // structureMutex held. Only pointers move: a request that resolved a
+    // limiter before the rehash keeps deciding on the same state. The old
+    // table and the dropped tombstones stay allocated for lookups that may
+    // still be walking them until the reclaimer frees them.
+    void rehash(size_t size) {
+        Table* old = table.load(std::memory_order_relaxed);
+        auto fresh = std::make_unique<Table>(size);
+        for (size_t i = 0; i < old->size(); i++) {
+            const Slot& slot = old->slots[i];
+            Entry* entry = slot.entry.load(std::memory_order_relaxed);
+            if (!entry) continue;
+            if (!entry->valid.load(std::memory_order_acquire)) {
+                reclaimer.retire(entry);
+                continue;
             }
             
-            newEntries[idx] = std::move(entry);
+            const uint32_t hash = slot.hash.load(std::memory_order_relaxed);
+            size_t idx = hash & fresh->mask;
+            while (fresh->slots[idx].entry.load(std::memory_order_relaxed)) {
+                idx = (idx + 1) & fresh->mask;
+            }
+            fresh->slots[idx].hash.store(hash, std::memory_order_relaxed);
+            fresh->slots[idx].entry.store(entry, std::memory_order_relaxed);
         }
         
-        BUCKET_COUNT.store(newSize, std::memory_order_release);
-        BUCKET_MASK.store(newSize - 1, std::memory_order_release);
-        Entry* old = entriesPtr.exchange(newEntries, std::memory_order_acq_rel);
-        delete[] old;
-        isResizing.store(false, std::memory_order_release);
+        table.store(fresh.release(), std::memory_order_seq_cst);
+        reclaimer.retire(old);
+        tombstoneCount = 0;
+    }
+
+    // Detach entry's stripes, keeping them allocated for requests on other
+    // threads that already hold them. Called with structureMutex held.
+    void retireStripes(Entry& entry) {
+        StripeSet* set = entry.stripes.exchange(nullptr, std::memory_order_seq_cst);
+        set->drain();
+        reclaimer.retire(set);
+    }
+
+    // Make entry the occupant of slot, retiring the tombstone or the
+    // limiter it replaces. The hash is stored first, so a lookup that sees
+    // the new entry also sees its hash.
+    void install(Slot& slot, uint32_t hash, Entry* entry) {
+        Entry* previous = slot.entry.load(std::memory_order_relaxed);
+        slot.hash.store(hash, std::memory_order_relaxed);
+        slot.entry.store(entry, std::memory_order_seq_cst);
+        reclaimer.retire(previous);
+    }
+
+    // A full, unblocked and unpenalized limiter is in the state ensureLimiter
+    // would recreate, so dropping it after idleTicks of that loses nothing.
+    // Distributed limiters are not refilled by maintenance, so one counts as
+    // full once a whole window has passed since its last refill; its shared
+    // count stays in the storage either way.
+    // The kEvicting claim lets a concurrent ensureLimiter see the eviction.
+    // idleSince wraps every ~49 days, so idle timeouts must stay below that.
+    bool evictIfIdle(Entry& entry, int64_t now, uint32_t nowMs, uint32_t idleMs) noexcept {
+        uint8_t state = entry.idleState.load(std::memory_order_acquire);
+        if (state == kPinned || state == kEvicting) return false;
+
+        const bool full = entry.policy.load(std::memory_order_relaxed) & kDistributed ?
+            now - entry.lastRefill.load(std::memory_order_acquire) >= entry.refillTime :
+            availableTokens(entry) >= entry.baseMaxTokens;
+        // A tenant's usage of the current fair-share window must survive
+        const bool idle = full && entry.shareEpoch.load(std::memory_order_relaxed) != now / entry.refillTime &&
+                          entry.blockUntil.load(std::memory_order_acquire) == 0 &&
+                          entry.penaltyPoints.load(std::memory_order_relaxed) <= 0;
+        if (!idle) {
+            if (state == kIdle) {
+                entry.idleState.compare_exchange_strong(state, kActive, std::memory_order_acq_rel);
+            }
+            return false;
+        }
+        if (state == kActive) {
+            entry.idleSince.store(nowMs, std::memory_order_relaxed);
+            entry.idleState.compare_exchange_strong(state, kIdle, std::memory_order_acq_rel);
+            return false;
+        }
+        if (nowMs - entry.idleSince.load(std::memory_order_relaxed) < idleMs ||
+            !entry.idleState.compare_exchange_strong(state, kEvicting, std::memory_order_acq_rel)) {
+            return false;
+        }
+        if (entry.valid.exchange(false, std::memory_order_acq_rel)) {
+            entryCount--;
+            tombstoneCount++;
+            return true;
+        }
+        return false;
+    }
+
+    // Tenant entries of a fair-share pool live in the main table under a
+    // derived key, so they resize and probe like any other limiter.
+    static std::string fairShareKey(const std::string& poolKey, const std::string& tenant) {
+        std::string k;
+        k.reserve(poolKey.size() + tenant.size() + 1);
+        k.append(poolKey).push_back('\x1f');
+        k.append(tenant);
+        return k;
+    }
+
+    // Tenants that requests create are evictable once idle, like the
+    // limiters rules create; a tenant given a weight is pinned so the weight
+    // is kept. Called with a Reclaimer::Pin held.
+    Entry* findOrCreateTenant(const std::string& poolKey, const std::string& tenant, int64_t refillTime,
+                              bool pinned) {
+        std::string tenantKey = fairShareKey(poolKey, tenant);
+        Entry* entry = findEntry(tenantKey);
+        if (entry) {
+            // Mark it in use; losing the race to an eviction means recreating it
+            uint8_t state = entry->idleState.load(std::memory_order_acquire);
+            while (state == kIdle && !entry->idleState.compare_exchange_weak(state, kActive,
+                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+            }
+            if (state == kPinned || (state != kEvicting && !pinned)) return entry;
+        }
+
+        // Evictions happen under the structure lock, so what is found here stays
+        std::lock_guard<std::mutex> lock(structureMutex);
+        entry = findEntry(tenantKey);
+        if (!entry) {
+            entry = insertLimiter(tenantKey, 0, refillTime, false, 0, 0, "", !pinned);
+            reclaimer.poll();
+        } else if (pinned) {
+            entry->idleState.store(kPinned, std::memory_order_release);
+        }
+        if (Entry* pool = findEntry(poolKey)) {
+            pool->hasTenants.store(true, std::memory_order_relaxed);
+        }
+        return entry;
+    }
+
+    // Invalidate the tenants of a removed pool. Called with structureMutex held.
+    void removeTenants(const std::string& poolKey) {
+        const std::string prefix = poolKey + '\x1f';
+        const Table& t = *table.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < t.size(); i++) {
+            Entry* entry = t.slots[i].entry.load(std::memory_order_relaxed);
+            if (entry && entry->key.compare(0, prefix.size(), prefix) == 0 &&
+                entry->valid.exchange(false, std::memory_order_acq_rel)) {
+                entryCount--;
+                tombstoneCount++;
+                releaseId(entry->key);
+            }
+        }
+    }
+
+    // A pool's active weight and the window it belongs to share one word, so
+    // the first tenant of a window starts the sum from zero in the same CAS
+    // that adds its weight; no rollover can wipe an add it did not see. The
+    // window is kept modulo 2^22, which only matters for a pool left unused
+    // for that many windows. A word no tenant has tagged yet is 0.
+    static constexpr int kShareWeightBits = 40;
+    static constexpr int64_t kShareWeightMask = (int64_t(1) << kShareWeightBits) - 1;
+    static constexpr int64_t kShareEpochMask = (int64_t(1) << 22) - 1;
+    static constexpr int64_t kShareTagged = int64_t(1) << 62;
+
+    static int64_t shareTag(int64_t epoch) noexcept {
+        return kShareTagged | ((epoch & kShareEpochMask) << kShareWeightBits);
+    }
+
+    struct ShareWeights {
+        int64_t active;    // Tenants active in the window
+        int64_t previous;  // Tenants active in the window before
+    };
+
+    static ShareWeights shareWeights(const Entry& pool, int64_t epoch) noexcept {
+        const int64_t word = pool.activeWeight.load(std::memory_order_acquire);
+        const int64_t tag = word & ~kShareWeightMask;
+        if (tag == shareTag(epoch)) {
+            return ShareWeights{word & kShareWeightMask, pool.prevActiveWeight.load(std::memory_order_acquire)};
+        }
+        // Nobody entered this window yet; the word still holds an older one
+        return ShareWeights{0, tag == shareTag(epoch - 1) ? word & kShareWeightMask : 0};
+    }
+
+    // Add delta to the pool's active weight for epoch. The first add of a
+    // window moves the previous window's sum to prevActiveWeight. An add for
+    // a window the pool has already left is dropped; the tenant adds its
+    // weight again when it enters the current one.
+    static void addActiveWeight(Entry& pool, int64_t epoch, int64_t delta) noexcept {
+        const int64_t tag = shareTag(epoch);
+        int64_t word = pool.activeWeight.load(std::memory_order_acquire);
+        while (true) {
+            const int64_t wordTag = word & ~kShareWeightMask;
+            const bool current = wordTag == tag;
+            if (!current && (word & kShareTagged) &&
+                (((wordTag - tag) >> kShareWeightBits) & kShareEpochMask) <= kShareEpochMask / 2) {
+                return;
+            }
+            const int64_t sum = std::max(int64_t(0), (current ? word & kShareWeightMask : 0) + delta);
+            if (pool.activeWeight.compare_exchange_weak(word, tag | std::min(sum, kShareWeightMask),
+                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (!current) {
+                    pool.prevActiveWeight.store(wordTag == shareTag(epoch - 1) ? word & kShareWeightMask : 0,
+                                                std::memory_order_release);
+                }
+                return;
+            }
+        }
+    }
+
+    // Start a new accounting window on the pool or tenant if the current one has expired.
+    // Returns true if this call performed the rollover.
+    static bool rollShareEpoch(Entry& entry, int64_t epoch) noexcept {
+        int64_t current = entry.shareEpoch.load(std::memory_order_acquire);
+        if (current == epoch) return false;
+        if (!entry.shareEpoch.compare_exchange_strong(current, epoch,
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return false;
+        }
+        entry.shareUsed.store(0, std::memory_order_release);
+        return true;
+    }
+
+    // Bring pool and tenant into the current window, registering the tenant's
+    // weight as active. Returns the window.
+    static int64_t enterShareWindow(Entry& pool, Entry& tenant, int64_t now) noexcept {
+        // Accounting windows are aligned to the pool's refill period
+        const int64_t epoch = now / pool.refillTime;
+        rollShareEpoch(pool, epoch);
+        if (rollShareEpoch(tenant, epoch)) {
+            addActiveWeight(pool, epoch, tenant.weight.load(std::memory_order_acquire));
+        }
+        return epoch;
     }
 
     struct RateLimitInfo {
@@ -372,19 +1022,43 @@ private:
         int64_t remaining;
         int64_t reset;
         bool blocked;
-        int64_t retryAfter;
+        int64_t retryAfter;  // Whole seconds left of a block, rounded up
+        int64_t window = 0;  // Refill time in ticks
+        // Ticks until a request can pass again: the rest of a block, or
+        // until an empty bucket has refilled its next token
+        int64_t retryTicks = 0;
     };
 
-    struct Metrics {
+    struct alignas(64) Metrics {
         std::atomic<uint64_t> totalRequests{0};
         std::atomic<uint64_t> allowedRequests{0};
         std::atomic<uint64_t> blockedRequests{0};
         std::atomic<uint64_t> penalizedRequests{0};
     } metrics;
 
-    // IP whitelist/blacklist using atomic shared pointers for lock-free updates
-    std::shared_ptr<std::unordered_set<std::string>> ipWhitelist;
-    std::shared_ptr<std::unordered_set<std::string>> ipBlacklist;
+    // Striped limiters count into per-thread shards so the shared counters
+    // above do not become the contended cache line instead
+    static constexpr size_t kMetricShards = 16;
+    std::array<Metrics, kMetricShards> stripedMetrics;
+
+    // IP whitelist/blacklist, copied on write and swapped with the atomic
+    // shared_ptr functions so readers on any thread take no lock of ours.
+    // Writers serialize on ipListMutex so concurrent updates are not lost.
+    // Lists are sorted, so a lookup is a binary search over string_views and
+    // never copies the address.
+    using IpList = std::vector<std::string>;
+    std::shared_ptr<const IpList> ipWhitelist;
+    std::shared_ptr<const IpList> ipBlacklist;
+    std::mutex ipListMutex;
+    // Lets tryRequest skip both list lookups while no IPs are listed
+    std::atomic<bool> hasIpLists{false};
+
+    void updateHasIpLists() noexcept {
+        auto white = std::atomic_load(&ipWhitelist);
+        auto black = std::atomic_load(&ipBlacklist);
+        hasIpLists.store((white && !white->empty()) || (black && !black->empty()),
+                         std::memory_order_release);
+    }
 
     // Time unit parser
     static int64_t parseTimeUnit(const std::string& duration) noexcept {
@@ -421,121 +1095,608 @@ private:
     void createLimiter(const std::string& key, int64_t maxTokens, const std::string& refillTime,
                       bool useSlidingWindow = false, const std::string& blockDuration = "",
                       int64_t maxPenaltyPoints = 0, const std::string& distributedKey = "") {
-        int64_t refillTimeMs = parseTimeUnit(refillTime);
-        int64_t blockDurationMs = parseTimeUnit(blockDuration);
+        int64_t refillTicks = parseTimeUnit(refillTime) * clock.ticksPerMs();
+        int64_t blockTicks = parseTimeUnit(blockDuration) * clock.ticksPerMs();
         
-        if (refillTimeMs <= 0) {
+        if (refillTicks <= 0) {
             throw std::invalid_argument("Invalid refill time duration: " + refillTime);
         }
         
-        createLimiter(key, maxTokens, refillTimeMs, useSlidingWindow, blockDurationMs,
+        createLimiter(key, maxTokens, refillTicks, useSlidingWindow, blockTicks,
                      maxPenaltyPoints, distributedKey);
     }
 
 public:
-    explicit RateLimiter(size_t bucketCount = 16384, DistributedStorage* storage = nullptr)
-        : BUCKET_COUNT(nextPowerOf2(std::max(size_t(1024), bucketCount))),
-          BUCKET_MASK(BUCKET_COUNT.load(std::memory_order_relaxed) - 1),
-          distributedStorage(storage) {
-        entries = new Entry[BUCKET_COUNT.load(std::memory_order_relaxed)];
-        entriesPtr.store(entries, std::memory_order_release);
-    }
+    // Limiter state owned by the caller (e.g. one per connection) instead of
+    // the hash table; see createHandle()
+    using Handle = Entry;
+
+    explicit RateLimiter(size_t bucketCount = 16384, DistributedStorage* storage = nullptr,
+                         ClockSource clockSource = ClockSource::Steady, int64_t clockTickMs = 1,
+                         ClockResolution resolution = ClockResolution::Milliseconds)
+        : RateLimiter(bucketCount, single(storage), clockSource, clockTickMs, resolution) {}
+
+    // One storage client per connection; a limiter shared across threads
+    // makes that many storage calls at once
+    RateLimiter(size_t bucketCount, StoragePool::Connections storage,
+                ClockSource clockSource = ClockSource::Steady, int64_t clockTickMs = 1,
+                ClockResolution resolution = ClockResolution::Milliseconds)
+        : distributedStorage(storage.empty() ? nullptr : new StoragePool(std::move(storage))),
+          policyMask(distributedStorage ? kPolicyCount - 1 : (kPolicyCount - 1) & ~kDistributed),
+          clock(clockSource, clockTickMs, resolution),
+          table(new Table(nextPowerOf2(std::max(size_t(1024), bucketCount)))) {}
 
     ~RateLimiter() {
-        delete[] entriesPtr.load(std::memory_order_acquire);
+        stopMaintenance();
+        Table* t = table.load(std::memory_order_acquire);
+        for (size_t i = 0; i < t->size(); i++) {
+            delete t->slots[i].entry.load(std::memory_order_relaxed);
+        }
+        delete t;
     }
 
-    void createLimiter(const std::string& key, int64_t maxTokens, int64_t refillTimeMs,
-                      bool useSlidingWindow = false, int64_t blockDurationMs = 0,
-                      int64_t maxPenaltyPoints = 0, const std::string& distributedKey = "") {
+    // Durations passed to and returned from the limiter are in this clock's ticks
+    const Clock& getClock() const noexcept {
+        return clock;
+    }
+
+    // Fast-forward a limiter running on the manual clock. Refills, block
+    // expiry and fair-share windows all follow the virtual time, so traffic
+    // can be replayed as fast as it can be fed in.
+    void advanceTime(int64_t ticks) {
+        if (ticks < 0) {
+            throw std::invalid_argument("Time cannot move backwards");
+        }
+        if (!clock.advance(ticks)) {
+            throw std::invalid_argument("advanceTime requires the manual clock");
+        }
+    }
+
+    struct MaintenanceResult {
+        size_t swept;      // Live limiters visited
+        size_t unblocked;  // Expired blocks cleared
+        size_t evicted;    // Idle on-demand limiters removed
+    };
+
+    // One incremental sweep over up to budget table slots, resuming where the
+    // previous one stopped. Expired blocks are cleared and local buckets
+    // refilled, so requests find them current; with idleTicks > 0, limiters
+    // made by ensureLimiter are evicted after staying idle that long.
+    // Distributed limiters are not refilled here: the request path owns their
+    // storage round-trips.
+    MaintenanceResult maintain(size_t budget, int64_t idleTicks = 0) {
+        std::lock_guard<std::mutex> lock(structureMutex);
+        const Table& t = *table.load(std::memory_order_acquire);
+        budget = std::min(budget, t.size());
+
+        const int64_t now = clock.now();
+        const int64_t ticksPerMs = clock.ticksPerMs();
+        const uint32_t nowMs = static_cast<uint32_t>(now / ticksPerMs);
+        const uint32_t idleMs = static_cast<uint32_t>((idleTicks + ticksPerMs - 1) / ticksPerMs);
+        MaintenanceResult result{0, 0, 0};
+        for (size_t i = 0; i < budget; i++) {
+            Entry* live = t.slots[sweepCursor++ & t.mask].entry.load(std::memory_order_relaxed);
+            if (!live || !live->valid.load(std::memory_order_acquire)) continue;
+            Entry& entry = *live;
+            result.swept++;
+
+            int64_t blockedUntil = entry.blockUntil.load(std::memory_order_acquire);
+            if (blockedUntil != 0 && blockedUntil <= now &&
+                entry.blockUntil.compare_exchange_strong(blockedUntil, 0, std::memory_order_acq_rel)) {
+                emit(LimiterEvent::Unblock, entry, now, 0);
+                result.unblocked++;
+            }
+
+            if (!(entry.policy.load(std::memory_order_relaxed) & kDistributed)) refillTokens(entry, now);
+
+            if (idleTicks > 0 && evictIfIdle(entry, now, nowMs, idleMs)) {
+                releaseId(entry.key);
+                result.evicted++;
+            }
+        }
+        reclaimer.poll();
+        return result;
+    }
+
+    // Run maintain() every intervalMs on a background thread, replacing any
+    // previous schedule
+    void startMaintenance(int64_t intervalMs, size_t budget, int64_t idleTicks = 0) {
+        if (intervalMs <= 0) {
+            throw std::invalid_argument("maintenance interval must be positive");
+        }
+        if (budget == 0) {
+            throw std::invalid_argument("maintenance batch must be positive");
+        }
+        stopMaintenance();
+        maintenanceStop = false;
+        maintenanceThread = std::thread([this, intervalMs, budget, idleTicks] {
+            std::unique_lock<std::mutex> lock(maintenanceMutex);
+            while (!maintenanceWake.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                                             [this] { return maintenanceStop; })) {
+                lock.unlock();
+                maintain(budget, idleTicks);
+                lock.lock();
+            }
+        });
+    }
+
+    void stopMaintenance() {
+        {
+            std::lock_guard<std::mutex> lock(maintenanceMutex);
+            maintenanceStop = true;
+        }
+        maintenanceWake.notify_all();
+        if (maintenanceThread.joinable()) {
+            maintenanceThread.join();
+        }
+    }
+
+    // Start reporting block, unblock and penalty transitions to a new
+    // subscriber. Returns its slot, for eventRing() and unsubscribeEvents().
+    // A slot's ring is sized by its first subscriber; a free slot whose ring
+    // is large enough is preferred.
+    size_t subscribeEvents(size_t capacity) {
+        std::lock_guard<std::mutex> lock(structureMutex);
+        uint32_t subscribers = eventSubscribers.load(std::memory_order_relaxed);
+        size_t chosen = kMaxEventSubscribers;
+        for (size_t slot = 0; slot < kMaxEventSubscribers; slot++) {
+            if (subscribers & (1u << slot)) continue;
+            if (eventRings[slot] && eventRings[slot]->capacity() >= capacity) {
+                chosen = slot;
+                break;
+            }
+            if (chosen == kMaxEventSubscribers || (!eventRings[slot] && eventRings[chosen])) chosen = slot;
+        }
+        if (chosen == kMaxEventSubscribers) {
+            throw std::runtime_error("Too many event subscribers");
+        }
+
+        if (eventRings[chosen]) {
+            eventRings[chosen]->discard();
+        } else {
+            eventRings[chosen] = std::make_unique<EventRing>(capacity);
+        }
+        eventSubscribers.fetch_or(1u << chosen, std::memory_order_release);
+        return chosen;
+    }
+
+    EventRing& eventRing(size_t slot) noexcept {
+        return *eventRings[slot];
+    }
+
+    // Stop reporting to one subscriber; the others keep their events
+    void unsubscribeEvents(size_t slot) noexcept {
+        eventSubscribers.fetch_and(~(1u << slot), std::memory_order_release);
+    }
+
+    // With withId, also returns an integer id for the *ById methods; the id
+    // survives reconfiguration and stays valid until removeLimiter. Returns
+    // the limiter's existing id, or 0 if it has none, otherwise.
+    uint32_t createLimiter(const std::string& key, int64_t maxTokens, int64_t refillTime,
+                           bool useSlidingWindow = false, int64_t blockDuration = 0,
+                           int64_t maxPenaltyPoints = 0, const std::string& distributedKey = "",
+                           bool withId = false) {
+        std::lock_guard<std::mutex> lock(structureMutex);
+        Entry* entry = insertLimiter(key, maxTokens, refillTime, useSlidingWindow, blockDuration,
+                                     maxPenaltyPoints, distributedKey, false);
+        const uint32_t id = withId ? assignId(key, entry) : idOf(key);
+        reclaimer.poll();
+        return id;
+    }
+
+private:
+    // Returns the limiter's entry
+    Entry* insertLimiter(const std::string& key, int64_t maxTokens, int64_t refillTime,
+                         bool useSlidingWindow, int64_t blockDuration, int64_t maxPenaltyPoints,
+                         const std::string& distributedKey, bool evictable) {
         if (key.empty()) {
             throw std::invalid_argument("Key cannot be empty");
         }
         if (maxTokens < 0) {
             throw std::invalid_argument("maxTokens cannot be negative");
         }
-        if (refillTimeMs <= 0) {
-            throw std::invalid_argument("refillTimeMs must be positive");
+        if (refillTime <= 0) {
+            throw std::invalid_argument("refillTime must be positive");
         }
-        if (blockDurationMs < 0) {
-            throw std::invalid_argument("blockDurationMs cannot be negative");
+        if (blockDuration < 0) {
+            throw std::invalid_argument("blockDuration cannot be negative");
+        }
+
+        // Tombstones lengthen probe chains as much as live limiters do, so
+        // both count toward the 1/2 load factor. When mostly tombstones
+        // filled the table, as under eviction churn, rehash at the same size
+        // to drop them instead of growing.
+        const size_t size = table.load(std::memory_order_relaxed)->size();
+        if ((entryCount + tombstoneCount + 1) * 2 > size) {
+            rehash((entryCount + 1) * 4 <= size ? size : size * 2);
         }
 
-        const size_t h = murmur3_32(key);
-        size_t idx = h & BUCKET_MASK.load(std::memory_order_relaxed);
-        size_t probes = 0;
-        size_t firstInvalidIdx = SIZE_MAX;
+        const uint32_t hash = static_cast<uint32_t>(murmur3_32(key));
+        Entry* created = new Entry(key, maxTokens, refillTime, useSlidingWindow, blockDuration,
+                                   maxPenaltyPoints, distributedKey, clock.now());
+        created->idleState.store(evictable ? kActive : kPinned, std::memory_order_relaxed);
 
         while (true) {
-            Entry& entry = entriesPtr.load(std::memory_order_relaxed)[idx];
-            bool isValid = entry.valid.load(std::memory_order_relaxed);
-            
-            if (!isValid && firstInvalidIdx == SIZE_MAX) {
-                firstInvalidIdx = idx;
+            Table& t = *table.load(std::memory_order_relaxed);
+            size_t idx = hash & t.mask;
+            Slot* reusable = nullptr;
+            for (size_t probes = 0; probes <= t.mask; probes++) {
+                Slot& slot = t.slots[idx];
+                Entry* entry = slot.entry.load(std::memory_order_relaxed);
+                if (!entry) {
+                    if (!reusable) reusable = &slot;
+                    break;
+                }
+                if (!entry->valid.load(std::memory_order_relaxed)) {
+                    // Tombstone: reusable, but the key may still live further along the chain
+                    if (!reusable) reusable = &slot;
+                } else if (slot.hash.load(std::memory_order_relaxed) == hash && entry->key == key) {
+                    // Reconfiguring replaces the limiter. Requests that already
+                    // hold the old one finish on it, as if they came first.
+                    // Its stripes are replaced by empty ones for the new limit.
+                    if (StripeSet* set = entry->stripes.load(std::memory_order_relaxed)) {
+                        created->stripes.store(new StripeSet(set->count, set->batch), std::memory_order_relaxed);
+                        created->policy.fetch_or(kStriped, std::memory_order_relaxed);
+                    }
+                    // Fair-share accounting is not a setting; it carries over
+                    created->shareEpoch.store(entry->shareEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+                    created->shareUsed.store(entry->shareUsed.load(std::memory_order_acquire), std::memory_order_relaxed);
+                    created->weight.store(entry->weight.load(std::memory_order_acquire), std::memory_order_relaxed);
+                    created->activeWeight.store(entry->activeWeight.load(std::memory_order_acquire), std::memory_order_relaxed);
+                    created->prevActiveWeight.store(entry->prevActiveWeight.load(std::memory_order_acquire),
+                                                    std::memory_order_relaxed);
+                    created->hasTenants.store(entry->hasTenants.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    install(slot, hash, created);
+                    if (uint32_t id = idOf(key)) {
+                        idSlot(id).entry.store(created, std::memory_order_seq_cst);
+                    }
+                    return created;
+                }
+                idx = (idx + 1) & t.mask;
             }
-            
-            if (isValid && entry.key == key) {
-                entry = Entry(key, maxTokens, refillTimeMs, useSlidingWindow,
-                            blockDurationMs, maxPenaltyPoints, distributedKey);
-                return;
+
+            if (reusable) {
+                if (reusable->entry.load(std::memory_order_relaxed)) tombstoneCount--;
+                install(*reusable, hash, created);
+                entryCount++;
+                return created;
             }
-            
-            idx = (idx + 1) & BUCKET_MASK.load(std::memory_order_relaxed);
-            probes++;
-            
-            if (probes >= BUCKET_COUNT.load(std::memory_order_relaxed)) {
-                if (firstInvalidIdx != SIZE_MAX) {
-                    entriesPtr.load(std::memory_order_relaxed)[firstInvalidIdx] = 
-                        Entry(key, maxTokens, refillTimeMs, useSlidingWindow,
-                              blockDurationMs, maxPenaltyPoints, distributedKey);
-                    entryCount.fetch_add(1, std::memory_order_relaxed);
-                    return;
+            rehash(t.size() * 2);
+        }
+    }
+
+public:
+    // Create the limiter, or reconfigure it if its settings differ. Leaves an
+    // up-to-date limiter alone so its tokens survive; returns true if it
+    // had to (re)create it. Limiters made here may be evicted by maintenance
+    // once idle, since the next call recreates them.
+    bool ensureLimiter(const std::string& key, int64_t maxTokens, int64_t refillTime,
+                       bool useSlidingWindow = false, int64_t blockDuration = 0,
+                       int64_t maxPenaltyPoints = 0, const std::string& distributedKey = "") {
+        {
+            Reclaimer::Pin pin(reclaimer);
+            Entry* entry = findEntry(key);
+            if (entry && entry->baseMaxTokens == maxTokens && entry->refillTime == refillTime &&
+                entry->isSlidingWindow == useSlidingWindow && entry->blockDuration == blockDuration &&
+                entry->maxPenaltyPoints == maxPenaltyPoints && entry->distributedKey == distributedKey) {
+                // Mark it in use; losing the race to an eviction means recreating it
+                uint8_t state = entry->idleState.load(std::memory_order_acquire);
+                while (state == kIdle && !entry->idleState.compare_exchange_weak(state, kActive,
+                           std::memory_order_acq_rel, std::memory_order_acquire)) {
                 }
-                resize();
-                idx = h & BUCKET_MASK.load(std::memory_order_relaxed);
-                probes = 0;
-                firstInvalidIdx = SIZE_MAX;
+                if (state != kEvicting) {
+                    return false;
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(structureMutex);
+        insertLimiter(key, maxTokens, refillTime, useSlidingWindow, blockDuration,
+                      maxPenaltyPoints, distributedKey, true);
+        reclaimer.poll();
+        return true;
+    }
+
+    // Opt a hot limiter into striped mode. stripes is rounded up to a power of
+    // two; batch is the number of tokens a stripe claims at once (0 picks a
+    // batch from the limit). stripes <= 1 returns the limiter to a single bucket.
+    void setStriping(const std::string& key, size_t stripes, int64_t batch = 0) {
+        std::lock_guard<std::mutex> lock(structureMutex);
+        Entry* entry = findEntry(key);
+        if (!entry) {
+            throw std::invalid_argument("Unknown limiter: " + key);
+        }
+        if (batch < 0) {
+            throw std::invalid_argument("batch cannot be negative");
+        }
+
+        if (stripes <= 1) {
+            if (StripeSet* set = entry->stripes.load(std::memory_order_relaxed)) {
+                entry->policy.fetch_and(static_cast<uint8_t>(~kStriped), std::memory_order_acq_rel);
+                entry->tokens.fetch_add(set->held(), std::memory_order_acq_rel);
+                retireStripes(*entry);
+                reclaimer.poll();
             }
+            return;
+        }
+
+        stripes = nextPowerOf2(stripes);
+        if (batch == 0) {
+            batch = std::max(int64_t(1), entry->baseMaxTokens / static_cast<int64_t>(stripes * 4));
+        }
+
+        // Return tokens held by any previous stripes before swapping them out
+        entry->policy.fetch_and(static_cast<uint8_t>(~kStriped), std::memory_order_acq_rel);
+        if (StripeSet* set = entry->stripes.load(std::memory_order_relaxed)) {
+            entry->tokens.fetch_add(set->held(), std::memory_order_acq_rel);
+            retireStripes(*entry);
+        }
+        entry->stripes.store(new StripeSet(stripes, batch), std::memory_order_seq_cst);
+        entry->policy.fetch_or(kStriped, std::memory_order_acq_rel);
+        reclaimer.poll();
+    }
+
+    // Allocate a standalone limiter that never enters the table, so it costs
+    // no hashing, probing or table capacity. Handles are never distributed or
+    // striped; penalties and block duration work as for keyed limiters.
+    std::unique_ptr<Handle> createHandle(int64_t maxTokens, int64_t refillTime,
+                                         bool useSlidingWindow = false, int64_t blockDuration = 0,
+                                         int64_t maxPenaltyPoints = 0) {
+        if (maxTokens < 0) {
+            throw std::invalid_argument("maxTokens cannot be negative");
+        }
+        if (refillTime <= 0) {
+            throw std::invalid_argument("refillTime must be positive");
+        }
+        if (blockDuration < 0) {
+            throw std::invalid_argument("blockDuration cannot be negative");
         }
+        return std::make_unique<Handle>(std::string(), maxTokens, refillTime, useSlidingWindow,
+                                        blockDuration, maxPenaltyPoints, std::string(), clock.now());
     }
 
-    bool tryRequest(const std::string& key, const std::string& ip = "") noexcept {
+    // tryRequest for a handle: same policy-specialized path, minus the lookup
+    bool consume(Handle& handle) noexcept {
+        return withPolicy(handle, [&](auto features) { return consume<decltype(features)>(handle); });
+    }
+
+    // Count a decision made outside the table, e.g. by a FixedKeyTable
+    void countDecision(bool allowed) noexcept {
         metrics.totalRequests.fetch_add(1, std::memory_order_relaxed);
+        (allowed ? metrics.allowedRequests : metrics.blockedRequests).fetch_add(1, std::memory_order_relaxed);
+    }
 
-        // Check IP blacklist/whitelist
-        if (!ip.empty()) {
-            if (isBlacklisted(ip)) {
-                metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
-                return false;
+    // Keys are views so callers can pass strings they do not own, e.g. an
+    // argument buffer of the binding; nothing on the allow path allocates
+    bool tryRequest(std::string_view key, std::string_view ip = {}) noexcept {
+        const int listed = ipListDecision(ip);
+        if (listed >= 0) return listed;
+
+        Reclaimer::Pin pin(reclaimer);
+        return decide(findEntry(key));
+    }
+
+    // Whether a distributed storage backs limiters given a distributed key
+    bool hasStorage() const noexcept {
+        return distributedStorage != nullptr;
+    }
+
+    // How many storage calls can be in flight at once
+    size_t storageConnections() const noexcept {
+        return distributedStorage ? distributedStorage->size() : 0;
+    }
+
+    // Whether deciding or reporting on key may call the distributed storage,
+    // i.e. block on a network round trip
+    bool usesStorage(std::string_view key) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        Entry* entry = findEntry(key);
+        return entry && entry->valid.load(std::memory_order_acquire) &&
+               (entry->policy.load(std::memory_order_relaxed) & policyMask & kDistributed);
+    }
+
+    // tryRequest followed by getRateLimitInfo, sharing one lookup
+    RateLimitInfo tryRequestInfo(std::string_view key, std::string_view ip, bool& allowed) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return decideWithInfo(findEntry(key), ip, allowed);
+    }
+
+    // tryRequestInfo for a limiter created on first use with these
+    // settings, as ensureLimiter creates it
+    RateLimitInfo tryRequestInfoOrCreate(std::string_view key, std::string_view ip, bool& allowed,
+                                         int64_t maxTokens, int64_t refillTime, bool useSlidingWindow,
+                                         int64_t blockDuration, int64_t maxPenaltyPoints) {
+        Reclaimer::Pin pin(reclaimer);
+        Entry* entry = findEntry(key);
+        if (!key.empty() && (!entry || !entry->valid.load(std::memory_order_acquire))) {
+            ensureLimiter(std::string(key), maxTokens, refillTime, useSlidingWindow, blockDuration,
+                          maxPenaltyPoints);
+            entry = findEntry(key);
+        }
+        return decideWithInfo(entry, ip, allowed);
+    }
+
+private:
+    RateLimitInfo decideWithInfo(Entry* entry, std::string_view ip, bool& allowed) noexcept {
+        const int listed = ipListDecision(ip);
+        allowed = listed >= 0 ? listed : decide(entry);
+        return rateLimitInfo(entry);
+    }
+
+public:
+    // 0 for a blacklisted and 1 for a whitelisted IP, counted as a request;
+    // -1 if the IP lists do not decide
+    int ipListDecision(std::string_view ip) noexcept {
+        if (ip.empty() || !hasIpLists.load(std::memory_order_acquire)) return -1;
+        if (isBlacklisted(ip)) {
+            metrics.totalRequests.fetch_add(1, std::memory_order_relaxed);
+            metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        if (isWhitelisted(ip)) {
+            metrics.totalRequests.fetch_add(1, std::memory_order_relaxed);
+            metrics.allowedRequests.fetch_add(1, std::memory_order_relaxed);
+            return 1;
+        }
+        return -1;
+    }
+
+    // tryRequest for an id from createLimiter. IP lists do not apply, as
+    // there is no client to check; an unknown or stale id is rejected.
+    bool tryRequestById(uint32_t id) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return decide(findEntryById(id));
+    }
+
+    static constexpr size_t kBatchGroup = 16;
+
+    // Decide on count keys in one call; costs may be null to take one token
+    // per key. results[i] is 1 if keys[i] was allowed. IP lists do not apply.
+    void tryRequestBatch(const std::string_view* keys, const int64_t* costs, size_t count,
+                         uint8_t* results) noexcept {
+        probeBatch(keys, count, [&](size_t i, Entry* entry) {
+            results[i] = decide(entry, costs ? costs[i] : 1);
+        });
+    }
+
+    // getRateLimitInfo for count keys in one call. Unknown keys report a
+    // limit and remaining of -1.
+    void getRateLimitInfoBatch(const std::string_view* keys, size_t count, RateLimitInfo* results) noexcept {
+        probeBatch(keys, count, [&](size_t i, Entry* entry) {
+            results[i] = entry && entry->valid.load(std::memory_order_acquire) ?
+                rateLimitInfo(entry) : RateLimitInfo{-1, -1, 0, false, 0};
+        });
+    }
+
+    // Look up count keys a group at a time: first all home slots of the
+    // group are hashed and prefetched, then the entries they point to, and
+    // only then are the chains probed. The cache misses of a group overlap
+    // instead of being paid one after another. fn(i, entry) gets a null
+    // entry for keys not in the table.
+    template <typename Fn>
+    void probeBatch(const std::string_view* keys, size_t count, Fn&& fn) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        const Table& t = *table.load(std::memory_order_seq_cst);
+        uint32_t hashes[kBatchGroup];
+
+        for (size_t base = 0; base < count; base += kBatchGroup) {
+            const size_t n = std::min(kBatchGroup, count - base);
+            for (size_t i = 0; i < n; i++) {
+                hashes[i] = static_cast<uint32_t>(murmur3_32(keys[base + i]));
+                __builtin_prefetch(&t.slots[hashes[i] & t.mask], 0, 3);
             }
-            if (isWhitelisted(ip)) {
-                metrics.allowedRequests.fetch_add(1, std::memory_order_relaxed);
-                return true;
+            for (size_t i = 0; i < n; i++) {
+                if (Entry* entry = t.slots[hashes[i] & t.mask].entry.load(std::memory_order_seq_cst)) {
+                    __builtin_prefetch(entry, 1, 3);
+                    __builtin_prefetch(&entry->key, 0, 3);
+                }
+            }
+            for (size_t i = 0; i < n; i++) {
+                std::string_view key = keys[base + i];
+                fn(base + i, key.empty() ? nullptr : probe(t, hashes[i] & t.mask, hashes[i], key));
             }
         }
+    }
 
-        Entry* entry = findEntry(key);
+    // Count a request to an unknown limiter as blocked, otherwise run the
+    // limiter's policy-specialized path. The caller pins entry.
+    bool decide(Entry* entry, int64_t cost = 1) noexcept {
         if (!entry || !entry->valid.load(std::memory_order_acquire)) {
+            metrics.totalRequests.fetch_add(1, std::memory_order_relaxed);
             metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
             return false;
         }
 
+        return withPolicy(*entry, [&](auto features) { return consume<decltype(features)>(*entry, cost); });
+    }
+
+    // Take cost tokens from the shared bucket
+    static bool takeToken(Entry& entry, int64_t cost = 1) noexcept {
+        return tryTakeTokens(entry.tokens, cost, 0, entry.dynamicMaxTokens.load(std::memory_order_relaxed));
+    }
+
+    static bool takeFromStripe(Stripe& stripe) noexcept {
+        return tryTakeTokens(stripe.tokens, 1);
+    }
+
+    // Slow path of a striped limiter: move a batch from the shared bucket into
+    // the caller's stripe, or steal from another stripe once the bucket is empty
+    static bool takeStriped(Entry& entry, StripeSet& set, Stripe& local) noexcept {
+        int64_t currentTokens = entry.tokens.load(std::memory_order_acquire);
+        while (currentTokens > 0) {
+            int64_t grab = std::min(currentTokens, set.batch);
+            if (entry.tokens.compare_exchange_weak(currentTokens, currentTokens - grab,
+                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (grab > 1) local.tokens.fetch_add(grab - 1, std::memory_order_release);
+                return true;
+            }
+        }
+        for (size_t i = 0; i < set.count; i++) {
+            if (takeFromStripe(set.slots[i])) return true;
+        }
+        return false;
+    }
+
+    static int64_t availableTokens(const Entry& entry) noexcept {
+        int64_t tokens = entry.tokens.load(std::memory_order_acquire);
+        const StripeSet* set = entry.stripes.load(std::memory_order_seq_cst);
+        if ((entry.policy.load(std::memory_order_acquire) & kStriped) && set) {
+            tokens += set->held();
+        }
+        return tokens;
+    }
+
+    // Request path specialized on the limiter's features. Striped limiters
+    // serve single tokens from stripes; larger costs go to the shared bucket.
+    template <typename F>
+    bool consume(Entry& entry, int64_t cost = 1) noexcept {
+        Metrics* m = &metrics;
+        // Read once: setStriping on another thread may swap the stripes
+        // between the policy dispatch and here, and a retired set stays
+        // allocated while the caller's pin holds
+        StripeSet* set = nullptr;
+        Stripe* stripe = nullptr;
+        if constexpr (F::striped) {
+            size_t slot = threadSlot();
+            m = &stripedMetrics[slot & (kMetricShards - 1)];
+            set = entry.stripes.load(std::memory_order_seq_cst);
+            if (set) stripe = &set->local(slot);
+        }
+        m->totalRequests.fetch_add(1, std::memory_order_relaxed);
+
+        // One clock read serves the whole decision. The striped fast path
+        // below needs no time unless the limiter can block.
+        int64_t now = F::block || !F::striped ? clock.now() : 0;
+
         // Check if blocked
-        int64_t now = getCurrentTimeMs();
-        int64_t blockedUntil = entry->blockUntil.load(std::memory_order_acquire);
-        if (blockedUntil > now) {
-            metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
-            return false;
+        if constexpr (F::block) {
+            int64_t blockedUntil = entry.blockUntil.load(std::memory_order_acquire);
+            if (blockedUntil > now) {
+                m->blockedRequests.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (blockedUntil != 0) unblockExpired(entry, blockedUntil, now);
+        }
+
+        // Striped limiters serve from the caller's stripe without touching the
+        // shared bucket; refill only happens once the stripe runs dry
+        if constexpr (F::striped) {
+            if (cost == 1 && stripe && takeFromStripe(*stripe)) {
+                return allow<F>(entry, *m);
+            }
+            if constexpr (!F::block) {
+                now = clock.now();
+            }
         }
 
         // Try to refill tokens
-        refillTokens(*entry);
+        refillTokens<F>(entry, now);
 
         // If we have distributed storage and a distributed key is set, check it first
-        if (distributedStorage && !entry->distributedKey.empty()) {
+        if constexpr (F::distributed) {
             try {
-                if (!distributedStorage->tryAcquire(entry->distributedKey, entry->dynamicMaxTokens.load(std::memory_order_acquire))) {
-                    metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
+                if (!distributedStorage->lease()->tryAcquire(entry.distributedKey,
+                        entry.dynamicMaxTokens.load(std::memory_order_acquire), cost)) {
+                    m->blockedRequests.fetch_add(1, std::memory_order_relaxed);
                     return false;
                 }
             } catch (...) {
@@ -545,65 +1706,266 @@ public:
         }
 
         // Try to consume a local token
-        int64_t currentTokens;
-        do {
-            currentTokens = entry->tokens.load(std::memory_order_acquire);
-            if (currentTokens <= 0) {
-                // If we acquired a distributed token but failed locally, release it
-                if (distributedStorage && !entry->distributedKey.empty()) {
-                    try {
-                        distributedStorage->release(entry->distributedKey, 1);
-                    } catch (...) {
-                        // Ignore Redis errors here
-                    }
-                }
-                // Set block duration if specified
-                if (entry->blockDurationMs > 0) {
-                    entry->blockUntil.store(now + entry->blockDurationMs, std::memory_order_release);
+        bool acquired;
+        if constexpr (F::striped) {
+            acquired = cost == 1 && stripe ? takeStriped(entry, *set, *stripe) : takeToken(entry, cost);
+        } else {
+            acquired = takeToken(entry, cost);
+        }
+        if (!acquired) {
+            // If we acquired a distributed token but failed locally, release it
+            if constexpr (F::distributed) {
+                try {
+                    distributedStorage->lease()->release(entry.distributedKey, cost);
+                } catch (...) {
+                    // Ignore Redis errors here
                 }
-                metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
-                return false;
             }
-        } while (!entry->tokens.compare_exchange_weak(currentTokens, currentTokens - 1,
-                std::memory_order_acq_rel, std::memory_order_acquire));
+            // Set block duration if specified
+            if constexpr (F::block) {
+                entry.blockUntil.store(now + entry.blockDuration, std::memory_order_release);
+                emit(LimiterEvent::Block, entry, now, now + entry.blockDuration);
+            }
+            m->blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
 
-        metrics.allowedRequests.fetch_add(1, std::memory_order_relaxed);
-        if (entry->penaltyPoints.load(std::memory_order_relaxed) > 0) {
-            metrics.penalizedRequests.fetch_add(1, std::memory_order_relaxed);
+        return allow<F>(entry, *m);
+    }
+
+    template <typename F>
+    bool allow(Entry& entry, Metrics& m) noexcept {
+        m.allowedRequests.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (F::penalty) {
+            if (entry.penaltyPoints.load(std::memory_order_relaxed) > 0) {
+                m.penalizedRequests.fetch_add(1, std::memory_order_relaxed);
+            }
         }
         return true;
     }
 
-    int64_t getTokens(const std::string& key) noexcept {
-        auto entry = findEntry(key);
-        if (!entry || !entry->valid.load(std::memory_order_relaxed)) {
-            return -1;
+    // Fair sharing of one limiter across tenants. The limiter under poolKey is the
+    // shared capacity; each tenant is entitled to weight/activeWeight of it per
+    // window (its deficit). A tenant past its entitlement may only borrow capacity
+    // the other active tenants have not yet claimed, so idle share is redistributed
+    // while a bursting tenant cannot starve the rest.
+    struct FairShareInfo {
+        int64_t weight;
+        int64_t share;
+        int64_t used;
+        int64_t activeWeight;
+    };
+
+    void setTenantWeight(const std::string& poolKey, const std::string& tenant, int64_t weight) {
+        if (weight <= 0) {
+            throw std::invalid_argument("weight must be positive");
+        }
+        Reclaimer::Pin pin(reclaimer);
+        Entry* pool = findEntry(poolKey);
+        if (!pool) {
+            throw std::invalid_argument("Unknown limiter: " + poolKey);
+        }
+        Entry* entry = findOrCreateTenant(poolKey, tenant, pool->refillTime, true);
+
+        // A registered tenant counts as active for the current window
+        int64_t previous = entry->weight.exchange(weight, std::memory_order_acq_rel);
+        int64_t epoch = entry->shareEpoch.load(std::memory_order_acquire);
+        if (epoch == enterShareWindow(*pool, *entry, clock.now())) {
+            // Already active: adjust the pool by the weight delta
+            addActiveWeight(*pool, epoch, weight - previous);
+        }
+    }
+
+    bool tryRequestFairShare(const std::string& poolKey, const std::string& tenant) {
+        metrics.totalRequests.fetch_add(1, std::memory_order_relaxed);
+
+        Reclaimer::Pin pin(reclaimer);
+        Entry* pool = findEntry(poolKey);
+        if (!pool || tenant.empty()) {
+            metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Entry* entry = findOrCreateTenant(poolKey, tenant, pool->refillTime, false);
+
+        int64_t now = clock.now();
+        if (pool->blockUntil.load(std::memory_order_acquire) > now) {
+            metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
-        return entry->tokens.load(std::memory_order_relaxed);
+
+        refillTokens(*pool, now);
+        const ShareWeights weights = shareWeights(*pool, enterShareWindow(*pool, *entry, now));
+
+        // Tenants seen in the previous window still count as active so the first
+        // tenant of a new window cannot claim the whole pool before others arrive
+        const int64_t w = entry->weight.load(std::memory_order_acquire);
+        const int64_t capacity = pool->dynamicMaxTokens.load(std::memory_order_acquire);
+        const int64_t totalWeight = std::max({weights.active, weights.previous, w});
+        const int64_t share = std::max(int64_t(1), (capacity * w) / totalWeight);
+        const int64_t used = entry->shareUsed.load(std::memory_order_acquire);
+
+        int64_t reserve = 0;
+        if (used >= share) {
+            // Deficit exhausted: leave enough for the other tenants' unclaimed share
+            int64_t othersUsed = pool->shareUsed.load(std::memory_order_acquire) - used;
+            reserve = std::max(int64_t(0), (capacity - share) - othersUsed);
+        }
+
+        if (!tryTakeTokens(pool->tokens, 1, reserve, pool->dynamicMaxTokens.load(std::memory_order_relaxed))) {
+            metrics.blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        entry->shareUsed.fetch_add(1, std::memory_order_relaxed);
+        pool->shareUsed.fetch_add(1, std::memory_order_relaxed);
+        metrics.allowedRequests.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    FairShareInfo getFairShareInfo(const std::string& poolKey, const std::string& tenant) {
+        Reclaimer::Pin pin(reclaimer);
+        Entry* pool = findEntry(poolKey);
+        Entry* entry = findEntry(fairShareKey(poolKey, tenant));
+        if (!pool || !entry) {
+            return FairShareInfo{0, 0, 0, 0};
+        }
+
+        const int64_t w = entry->weight.load(std::memory_order_acquire);
+        const ShareWeights weights = shareWeights(*pool, clock.now() / pool->refillTime);
+        const int64_t totalWeight = std::max({weights.active, weights.previous, w});
+        const int64_t capacity = pool->dynamicMaxTokens.load(std::memory_order_acquire);
+        const bool current = entry->shareEpoch.load(std::memory_order_acquire) ==
+                             pool->shareEpoch.load(std::memory_order_acquire);
+        return FairShareInfo{
+            w,
+            std::max(int64_t(1), (capacity * w) / totalWeight),
+            current ? entry->shareUsed.load(std::memory_order_acquire) : 0,
+            totalWeight
+        };
+    }
+
+    // Bandwidth limiters are sliding-window buckets denominated in bytes:
+    // burstBytes is the bucket size and it refills at bytesPerSecond
+    void createBandwidthLimiter(const std::string& key, int64_t bytesPerSecond, int64_t burstBytes) {
+        int64_t window = bandwidthWindow(bytesPerSecond, burstBytes);
+        createLimiter(key, burstBytes, window, true);
+    }
+
+    // createBandwidthLimiter as ensureLimiter does it: an up-to-date limiter
+    // is left alone, and maintenance may evict it once idle
+    bool ensureBandwidthLimiter(const std::string& key, int64_t bytesPerSecond, int64_t burstBytes) {
+        int64_t window = bandwidthWindow(bytesPerSecond, burstBytes);
+        return ensureLimiter(key, burstBytes, window, true);
     }
 
-    void removeLimiter(const std::string& key) noexcept {
+private:
+    // Validates the settings, raises burstBytes to at least one tick of
+    // traffic and returns the window it refills over
+    int64_t bandwidthWindow(int64_t bytesPerSecond, int64_t& burstBytes) const {
+        if (bytesPerSecond <= 0) {
+            throw std::invalid_argument("bytesPerSecond must be positive");
+        }
+        if (burstBytes <= 0) {
+            throw std::invalid_argument("burstBytes must be positive");
+        }
+        // The window is whole clock ticks, so the burst covers at least one
+        const int64_t ticksPerSecond = 1000 * clock.ticksPerMs();
+        burstBytes = std::max(burstBytes, (bytesPerSecond + ticksPerSecond - 1) / ticksPerSecond);
+        return std::max(int64_t(1), burstBytes * ticksPerSecond / bytesPerSecond);
+    }
+
+public:
+    // Debit bytes from a limiter and return how many clock ticks the caller
+    // should hold them back. The bucket may go into debt so that consecutive
+    // chunks queue up behind each other at the refill rate instead of being
+    // rejected; block and penalty settings do not apply to shaping.
+    int64_t consumeBytes(std::string_view key, int64_t bytes) {
+        if (bytes < 0) {
+            throw std::invalid_argument("bytes cannot be negative");
+        }
+        Reclaimer::Pin pin(reclaimer);
+        Entry* entry = findEntry(key);
+        if (!entry || !entry->valid.load(std::memory_order_acquire)) {
+            throw std::invalid_argument("Unknown limiter: " + std::string(key));
+        }
+
+        refillTokens(*entry);
+        int64_t remaining = entry->tokens.fetch_sub(bytes, std::memory_order_acq_rel) - bytes;
+        if (remaining >= 0) return 0;
+
+        int64_t limit = std::max(int64_t(1), entry->dynamicMaxTokens.load(std::memory_order_relaxed));
+        return (-remaining * entry->refillTime + limit - 1) / limit;
+    }
+
+    // Charge an extra cost to a limiter after the fact, e.g. once a response
+    // has shown how expensive the request was. Unlike tryRequest this never
+    // fails: the bucket goes into debt, requests are rejected until refills
+    // have repaid it, and the remaining (possibly negative) balance is returned.
+    // A distributed limiter is debited in storage as well, so the other
+    // instances see the cost.
+    int64_t charge(std::string_view key, int64_t cost) {
+        if (cost < 0) {
+            throw std::invalid_argument("cost cannot be negative");
+        }
+        Reclaimer::Pin pin(reclaimer);
+        Entry* entry = findEntry(key);
+        if (!entry || !entry->valid.load(std::memory_order_acquire)) {
+            throw std::invalid_argument("Unknown limiter: " + std::string(key));
+        }
+
+        refillTokens(*entry);
+        if (cost > 0 && (entry->policy.load(std::memory_order_acquire) & policyMask & kDistributed)) {
+            // release() of a negative amount debits the shared bucket, which
+            // may go into debt just like the local one
+            try {
+                distributedStorage->lease()->release(entry->distributedKey, -cost);
+            } catch (...) {
+                // Storage might be temporarily unavailable; the local debit still holds
+            }
+        }
+        return entry->tokens.fetch_sub(cost, std::memory_order_acq_rel) - cost;
+    }
+
+    int64_t getTokens(std::string_view key) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return tokensOf(findEntry(key));
+    }
+
+    int64_t getTokensById(uint32_t id) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return tokensOf(findEntryById(id));
+    }
+
+    void removeLimiter(const std::string& key) {
+        std::lock_guard<std::mutex> lock(structureMutex);
         if (auto entry = findEntry(key)) {
             if (entry->valid.exchange(false, std::memory_order_acq_rel)) {
-                entryCount.fetch_sub(1, std::memory_order_relaxed);
+                entryCount--;
+                tombstoneCount++;
+                releaseId(key);
+                if (entry->hasTenants.load(std::memory_order_relaxed)) removeTenants(key);
             }
         }
     }
 
     // Add penalty points to reduce rate limit
     void addPenalty(const std::string& key, int64_t points) noexcept {
+        Reclaimer::Pin pin(reclaimer);
         if (auto entry = findEntry(key)) {
             if (entry->maxPenaltyPoints > 0) {
-                entry->penaltyPoints.fetch_add(points, std::memory_order_relaxed);
+                int64_t total = entry->penaltyPoints.fetch_add(points, std::memory_order_relaxed) + points;
                 // Update dynamic limit immediately
                 int64_t dynamicLimit = entry->calculateDynamicLimit();
                 entry->dynamicMaxTokens.store(dynamicLimit, std::memory_order_release);
+                emit(LimiterEvent::Penalty, *entry, clock.now(), total);
             }
         }
     }
 
     // Remove penalty points to restore rate limit
     void removePenalty(const std::string& key, int64_t points) noexcept {
+        Reclaimer::Pin pin(reclaimer);
         if (auto entry = findEntry(key)) {
             if (entry->maxPenaltyPoints > 0) {
                 int64_t current = entry->penaltyPoints.load(std::memory_order_relaxed);
@@ -615,6 +1977,7 @@ public:
                         // Update dynamic limit immediately
                         int64_t dynamicLimit = entry->calculateDynamicLimit();
                         entry->dynamicMaxTokens.store(dynamicLimit, std::memory_order_release);
+                        emit(LimiterEvent::Penalty, *entry, clock.now(), newValue);
                         break;
                     }
                 }
@@ -623,7 +1986,8 @@ public:
     }
 
     // Get current rate limit including dynamic adjustments
-    int64_t getCurrentLimit(const std::string& key) noexcept {
+    int64_t getCurrentLimit(std::string_view key) noexcept {
+        Reclaimer::Pin pin(reclaimer);
         if (auto entry = findEntry(key)) {
             return entry->dynamicMaxTokens.load(std::memory_order_relaxed);
         }
@@ -631,88 +1995,125 @@ public:
     }
 
     // HTTP integration methods
-    RateLimitInfo getRateLimitInfo(const std::string& key) noexcept {
-        Entry* entry = findEntry(key);
+    RateLimitInfo getRateLimitInfo(std::string_view key) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return rateLimitInfo(findEntry(key));
+    }
+
+    RateLimitInfo getRateLimitInfoById(uint32_t id) noexcept {
+        Reclaimer::Pin pin(reclaimer);
+        return rateLimitInfo(findEntryById(id));
+    }
+
+private:
+    static int64_t tokensOf(Entry* entry) noexcept {
+        if (!entry || !entry->valid.load(std::memory_order_relaxed)) {
+            return -1;
+        }
+        // A bucket in debt reports empty; -1 is reserved for unknown keys
+        return std::max(int64_t(0), availableTokens(*entry));
+    }
+
+    RateLimitInfo rateLimitInfo(Entry* entry) noexcept {
         if (!entry || !entry->valid.load(std::memory_order_acquire)) {
             return RateLimitInfo{0, 0, 0, false, 0};
         }
         
         // Refill tokens first to get accurate count
-        refillTokens(*entry);
+        int64_t now = clock.now();
+        refillTokens(*entry, now);
         
         int64_t dynamicLimit = entry->calculateDynamicLimit();
-        int64_t currentTokens = entry->tokens.load(std::memory_order_acquire);
+        int64_t currentTokens = availableTokens(*entry);
         int64_t blockedUntil = entry->blockUntil.load(std::memory_order_acquire);
-        int64_t now = getCurrentTimeMs();
         
         bool blocked = blockedUntil > now;
-        int64_t retryAfter = blocked ? (blockedUntil - now) / 1000 : 0;
+        const int64_t ticksPerSecond = 1000 * clock.ticksPerMs();
+        int64_t retryAfter = blocked ? (blockedUntil - now + ticksPerSecond - 1) / ticksPerSecond : 0;
+        
+        // Calculate reset time
+        int64_t lastRefill = entry->lastRefill.load(std::memory_order_acquire);
+        int64_t reset = lastRefill + entry->refillTime;
+
+        int64_t retryTicks = 0;
+        if (blocked) {
+            retryTicks = blockedUntil - now;
+        } else if (currentTokens < 1) {
+            // A sliding window refills tokens one by one; it takes
+            // 1 - currentTokens of them, more if charge() left a debt.
+            // A fixed window refills all at once at the reset.
+            const int64_t limit = std::max(int64_t(1), dynamicLimit);
+            retryTicks = entry->isSlidingWindow ?
+                lastRefill + ((1 - currentTokens) * entry->refillTime + limit - 1) / limit - now :
+                reset - now;
+            retryTicks = std::max(int64_t(0), retryTicks);
+        }
         
         // If we're blocked, remaining should be 0
         if (blocked) {
             currentTokens = 0;
         }
         
-        // Calculate reset time
-        int64_t lastRefill = entry->lastRefill.load(std::memory_order_acquire);
-        int64_t reset = lastRefill + entry->refillTimeMs;
-        
         return RateLimitInfo{
             dynamicLimit,
             std::max(int64_t(0), currentTokens),
             reset,
             blocked,
-            retryAfter
+            retryAfter,
+            entry->refillTime,
+            retryTicks
         };
     }
 
+public:
     // IP whitelist/blacklist management
     void addToWhitelist(const std::string& ip) {
-        auto current = ipWhitelist;
-        if (!current) {
-            current = std::make_shared<std::unordered_set<std::string>>();
-        }
-        auto updated = std::make_shared<std::unordered_set<std::string>>(*current);
-        updated->insert(ip);
-        ipWhitelist = updated;
+        updateIpList(ipWhitelist, ip, true);
     }
 
     void addToBlacklist(const std::string& ip) {
-        auto current = ipBlacklist;
-        if (!current) {
-            current = std::make_shared<std::unordered_set<std::string>>();
-        }
-        auto updated = std::make_shared<std::unordered_set<std::string>>(*current);
-        updated->insert(ip);
-        ipBlacklist = updated;
+        updateIpList(ipBlacklist, ip, true);
     }
 
     void removeFromWhitelist(const std::string& ip) {
-        auto current = ipWhitelist;
-        if (!current) return;
-        auto updated = std::make_shared<std::unordered_set<std::string>>(*current);
-        updated->erase(ip);
-        ipWhitelist = updated;
+        updateIpList(ipWhitelist, ip, false);
     }
 
     void removeFromBlacklist(const std::string& ip) {
-        auto current = ipBlacklist;
-        if (!current) return;
-        auto updated = std::make_shared<std::unordered_set<std::string>>(*current);
-        updated->erase(ip);
-        ipBlacklist = updated;
+        updateIpList(ipBlacklist, ip, false);
     }
 
-    bool isWhitelisted(const std::string& ip) const noexcept {
-        auto list = ipWhitelist;
-        return list && list->count(ip) > 0;
+    bool isWhitelisted(std::string_view ip) const noexcept {
+        return listed(std::atomic_load(&ipWhitelist), ip);
     }
 
-    bool isBlacklisted(const std::string& ip) const noexcept {
-        auto list = ipBlacklist;
-        return list && list->count(ip) > 0;
+    bool isBlacklisted(std::string_view ip) const noexcept {
+        return listed(std::atomic_load(&ipBlacklist), ip);
     }
 
+private:
+    static bool listed(const std::shared_ptr<const IpList>& list, std::string_view ip) noexcept {
+        return list && std::binary_search(list->begin(), list->end(), ip,
+            [](std::string_view a, std::string_view b) { return a < b; });
+    }
+
+    void updateIpList(std::shared_ptr<const IpList>& list, const std::string& ip, bool add) {
+        std::lock_guard<std::mutex> lock(ipListMutex);
+        auto current = std::atomic_load(&list);
+        auto updated = current ? std::make_shared<IpList>(*current) : std::make_shared<IpList>();
+        auto at = std::lower_bound(updated->begin(), updated->end(), ip);
+        const bool present = at != updated->end() && *at == ip;
+        if (add == present) return;
+        if (add) {
+            updated->insert(at, ip);
+        } else {
+            updated->erase(at);
+        }
+        std::atomic_store(&list, std::shared_ptr<const IpList>(std::move(updated)));
+        updateHasIpLists();
+    }
+
+public:
     // Monitoring methods
     struct MonitoringStats {
         uint64_t totalRequests;
@@ -729,6 +2130,12 @@ public:
         uint64_t allowed = metrics.allowedRequests.load(std::memory_order_relaxed);
         uint64_t blocked = metrics.blockedRequests.load(std::memory_order_relaxed);
         uint64_t penalized = metrics.penalizedRequests.load(std::memory_order_relaxed);
+        for (const Metrics& shard : stripedMetrics) {
+            total += shard.totalRequests.load(std::memory_order_relaxed);
+            allowed += shard.allowedRequests.load(std::memory_order_relaxed);
+            blocked += shard.blockedRequests.load(std::memory_order_relaxed);
+            penalized += shard.penalizedRequests.load(std::memory_order_relaxed);
+        }
         
         return MonitoringStats{
             total,
@@ -741,11 +2148,40 @@ public:
         };
     }
 
+    struct TableStats {
+        size_t capacity;        // Table slots
+        size_t limiters;        // Live limiters
+        size_t tombstones;      // Slots of removed limiters not yet reclaimed
+        size_t maxProbeLength;  // Most slots a lookup walks, a miss included
+    };
+
+    // Walks the whole table under the structure lock; meant for diagnostics.
+    // A lookup stops at the first empty slot, so the longest run of occupied
+    // slots, tombstones included, bounds every probe.
+    TableStats getTableStats() {
+        std::lock_guard<std::mutex> lock(structureMutex);
+        const Table& t = *table.load(std::memory_order_relaxed);
+        size_t longest = 0;
+        size_t run = 0;
+        // Two passes so a run that wraps past the last slot is measured whole
+        for (size_t i = 0; i < t.size() * 2 && longest < t.size(); i++) {
+            run = t.slots[i & t.mask].entry.load(std::memory_order_relaxed) ? run + 1 : 0;
+            longest = std::max(longest, run);
+        }
+        return TableStats{t.size(), entryCount, tombstoneCount, std::min(longest + 1, t.size())};
+    }
+
     // Reset monitoring stats
     void resetStats() noexcept {
         metrics.totalRequests.store(0, std::memory_order_relaxed);
         metrics.allowedRequests.store(0, std::memory_order_relaxed);
         metrics.blockedRequests.store(0, std::memory_order_relaxed);
         metrics.penalizedRequests.store(0, std::memory_order_relaxed);
+        for (Metrics& shard : stripedMetrics) {
+            shard.totalRequests.store(0, std::memory_order_relaxed);
+            shard.allowedRequests.store(0, std::memory_order_relaxed);
+            shard.blockedRequests.store(0, std::memory_order_relaxed);
+            shard.penalizedRequests.store(0, std::memory_order_relaxed);
+        }
     }
 }; 
\ No newline at end of file
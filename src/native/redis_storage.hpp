@@ -33,11 +33,12 @@ public:
         if (redis) g_redisLoader.redisFree(redis);
     }
 
-    bool tryAcquire(const std::string& key, int64_t tokens) override {
+    bool tryAcquire(const std::string& key, int64_t maxTokens, int64_t cost) override {
         const std::string fullKey = prefix + key;
         const char* script = R"(
             local key = KEYS[1]
             local max_tokens = tonumber(ARGV[1])
+            local cost = tonumber(ARGV[2])
             
             -- Get current tokens, initialize if not exists
             local current = redis.call('GET', key)
@@ -47,17 +48,17 @@ public:
             end
             current = tonumber(current)
             
-            -- Try to acquire a token
-            if current > 0 then
-                redis.call('DECRBY', key, 1)
+            -- Try to acquire cost tokens
+            if current >= cost then
+                redis.call('DECRBY', key, cost)
                 return 1
             end
             return 0
         )";
 
         redisReply* reply = (redisReply*)g_redisLoader.redisCommand(redis,
-            "EVAL %s 1 %s %lld",
-            script, fullKey.c_str(), tokens);
+            "EVAL %s 1 %s %lld %lld",
+            script, fullKey.c_str(), maxTokens, cost);
 
         if (!reply) {
             throw std::runtime_error("Redis command failed");
@@ -83,11 +84,22 @@ public:
     
     void reset(const std::string& key, int64_t maxTokens) override {
         std::string fullKey = prefix + key;
-        
-        // SET key maxTokens
+        const char* script = R"(
+            local key = KEYS[1]
+            local max_tokens = tonumber(ARGV[1])
+
+            -- Debt charged in the old window is repaid out of the new one
+            local current = tonumber(redis.call('GET', key))
+            if current and current < 0 then
+                max_tokens = max_tokens + current
+            end
+            redis.call('SET', key, max_tokens)
+            return max_tokens
+        )";
+
         redisReply* reply = (redisReply*)g_redisLoader.redisCommand(redis,
-            "SET %s %lld",
-            fullKey.c_str(), maxTokens);
+            "EVAL %s 1 %s %lld",
+            script, fullKey.c_str(), maxTokens);
 
         if (!reply) {
             throw std::runtime_error("Redis command failed");
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Declarative rules that pick a limit and build the limiter key for a request.
+//
+// A rule matches on HTTP method, a path pattern and header values. Patterns
+// are compiled into a trie over path segments: literal segments are hashed,
+// ':name' and '*' match any single segment and a trailing '**' matches the
+// rest of the path. Rules are tried in declaration order and the first match
+// wins, so specific rules go before catch-alls.
+//
+// Key templates are compiled too. Placeholders: {name}, {method}, {path},
+// {client}, {param.<name>} and {header.<name>}; everything else is literal.
+
+// Window and block are in ticks of the limiter's clock
+struct RuleLimit {
+    int64_t maxTokens = 0;
+    int64_t window = 0;
+    bool sliding = false;
+    int64_t block = 0;
+    int64_t maxPenalty = 0;
+};
+
+// Rule as handed over by the binding, before compilation
+struct RuleSpec {
+    std::string name;
+    std::vector<std::string> methods;                          // Empty matches any method
+    std::string path;                                          // Empty matches any path
+    std::vector<std::pair<std::string, std::string>> headers;  // Value "*" only requires presence
+    std::string key;                                           // Empty means "{name}:{client}"
+    RuleLimit limit;
+};
+
+class RuleSet {
+private:
+    static constexpr uint32_t kAnyMethod = 0xffffffffu;
+    static constexpr uint32_t kNoRule = 0xffffffffu;
+
+    struct Node {
+        struct Literal {
+            size_t hash;
+            std::string segment;
+            std::unique_ptr<Node> node;
+        };
+        std::vector<Literal> literals;
+        std::unique_ptr<Node> wildcard;   // ':name' or '*'
+        std::vector<uint32_t> rules;      // Rules whose pattern ends here
+        std::vector<uint32_t> tailRules;  // Rules ending in '**' at this depth
+    };
+
+    struct HeaderMatcher {
+        size_t header;   // Index into headerNames
+        bool anyValue;
+        size_t hash;
+        std::string value;
+    };
+
+    struct KeyPart {
+        enum Kind { Literal, Name, Method, Path, Client, Param, Header } kind;
+        std::string text;  // Literal text
+        size_t index;      // Segment position for Param, header index for Header
+    };
+
+    struct Rule {
+        std::string name;
+        uint32_t methods;
+        std::vector<HeaderMatcher> headers;
+        std::vector<KeyPart> key;
+        RuleLimit limit;
+    };
+
+    Node root;
+    std::vector<Rule> rules;
+    std::vector<std::string> headerNames;
+
+    static size_t hashOf(std::string_view value) noexcept {
+        return std::hash<std::string_view>{}(value);
+    }
+
+    static uint32_t methodBit(std::string_view method) noexcept {
+        static const char* const kMethods[] = {
+            "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "CONNECT", "TRACE"
+        };
+        for (uint32_t i = 0; i < sizeof(kMethods) / sizeof(kMethods[0]); i++) {
+            if (method == kMethods[i]) return 1u << i;
+        }
+        return 0;
+    }
+
+    static std::string lower(std::string value) {
+        for (char& c : value) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return value;
+    }
+
+    static std::string upper(std::string value) {
+        for (char& c : value) {
+            if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        }
+        return value;
+    }
+
+    // Split a path into segments, ignoring the query string and empty segments
+    template <typename Fn>
+    static void forEachSegment(std::string_view path, Fn&& fn) {
+        size_t query = path.find('?');
+        if (query != std::string_view::npos) path = path.substr(0, query);
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == std::string_view::npos) end = path.size();
+            if (end > start) fn(path.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    size_t headerIndex(const std::string& name) {
+        std::string normalized = lower(name);
+        for (size_t i = 0; i < headerNames.size(); i++) {
+            if (headerNames[i] == normalized) return i;
+        }
+        headerNames.push_back(std::move(normalized));
+        return headerNames.size() - 1;
+    }
+
+    // Insert a path pattern and return the parameter names by segment position
+    std::vector<std::pair<std::string, size_t>> insertPath(const std::string& pattern, uint32_t ruleIndex) {
+        std::vector<std::pair<std::string, size_t>> params;
+        std::vector<std::string_view> segments;
+        forEachSegment(pattern, [&](std::string_view segment) { segments.push_back(segment); });
+
+        Node* node = &root;
+        for (size_t i = 0; i < segments.size(); i++) {
+            std::string_view segment = segments[i];
+            if (segment == "**") {
+                if (i + 1 != segments.size()) {
+                    throw std::invalid_argument("'**' must be the last segment of a rule path: " + pattern);
+                }
+                node->tailRules.push_back(ruleIndex);
+                return params;
+            }
+            if (segment == "*" || segment[0] == ':') {
+                if (segment[0] == ':') {
+                    params.emplace_back(std::string(segment.substr(1)), i);
+                }
+                if (!node->wildcard) node->wildcard = std::make_unique<Node>();
+                node = node->wildcard.get();
+                continue;
+            }
+
+            size_t hash = hashOf(segment);
+            Node* next = nullptr;
+            for (auto& literal : node->literals) {
+                if (literal.hash == hash && literal.segment == segment) {
+                    next = literal.node.get();
+                    break;
+                }
+            }
+            if (!next) {
+                node->literals.push_back({hash, std::string(segment), std::make_unique<Node>()});
+                next = node->literals.back().node.get();
+            }
+            node = next;
+        }
+        node->rules.push_back(ruleIndex);
+        return params;
+    }
+
+    std::vector<KeyPart> compileKey(const std::string& pattern,
+                                    const std::vector<std::pair<std::string, size_t>>& params) {
+        std::vector<KeyPart> parts;
+        size_t pos = 0;
+        while (pos < pattern.size()) {
+            size_t open = pattern.find('{', pos);
+            if (open == std::string::npos) {
+                parts.push_back({KeyPart::Literal, pattern.substr(pos), 0});
+                break;
+            }
+            if (open > pos) {
+                parts.push_back({KeyPart::Literal, pattern.substr(pos, open - pos), 0});
+            }
+            size_t close = pattern.find('}', open);
+            if (close == std::string::npos) {
+                throw std::invalid_argument("Unterminated placeholder in rule key: " + pattern);
+            }
+
+            std::string placeholder = pattern.substr(open + 1, close - open - 1);
+            if (placeholder == "name") {
+                parts.push_back({KeyPart::Name, "", 0});
+            } else if (placeholder == "method") {
+                parts.push_back({KeyPart::Method, "", 0});
+            } else if (placeholder == "path") {
+                parts.push_back({KeyPart::Path, "", 0});
+            } else if (placeholder == "client") {
+                parts.push_back({KeyPart::Client, "", 0});
+            } else if (placeholder.compare(0, 6, "param.") == 0) {
+                std::string param = placeholder.substr(6);
+                auto it = std::find_if(params.begin(), params.end(),
+                    [&](const auto& p) { return p.first == param; });
+                if (it == params.end()) {
+                    throw std::invalid_argument("Rule key uses unknown path parameter: " + param);
+                }
+                parts.push_back({KeyPart::Param, "", it->second});
+            } else if (placeholder.compare(0, 7, "header.") == 0) {
+                parts.push_back({KeyPart::Header, "", headerIndex(placeholder.substr(7))});
+            } else {
+                throw std::invalid_argument("Unknown placeholder in rule key: {" + placeholder + "}");
+            }
+            pos = close + 1;
+        }
+        return parts;
+    }
+
+    // Depth-first walk over every trie branch the path can take, keeping the
+    // lowest-numbered rule whose method and headers also match
+    void collect(const Node& node, const std::vector<std::string_view>& segments, size_t depth,
+                 uint32_t methodMask, const std::vector<size_t>& headerHashes,
+                 const std::vector<std::string_view>& headerValues, uint32_t& best) const {
+        for (uint32_t rule : node.tailRules) {
+            consider(rule, methodMask, headerHashes, headerValues, best);
+        }
+        if (depth == segments.size()) {
+            for (uint32_t rule : node.rules) {
+                consider(rule, methodMask, headerHashes, headerValues, best);
+            }
+            return;
+        }
+
+        std::string_view segment = segments[depth];
+        size_t hash = hashOf(segment);
+        for (const auto& literal : node.literals) {
+            if (literal.hash == hash && literal.segment == segment) {
+                collect(*literal.node, segments, depth + 1, methodMask, headerHashes, headerValues, best);
+                break;
+            }
+        }
+        if (node.wildcard) {
+            collect(*node.wildcard, segments, depth + 1, methodMask, headerHashes, headerValues, best);
+        }
+    }
+
+    void consider(uint32_t index, uint32_t methodMask, const std::vector<size_t>& headerHashes,
+                  const std::vector<std::string_view>& headerValues, uint32_t& best) const {
+        if (index >= best) return;
+        const Rule& rule = rules[index];
+        if (!(rule.methods & methodMask)) return;
+        for (const auto& matcher : rule.headers) {
+            std::string_view value = headerValues[matcher.header];
+            if (matcher.anyValue) {
+                if (value.empty()) return;
+            } else if (headerHashes[matcher.header] != matcher.hash || value != matcher.value) {
+                return;
+            }
+        }
+        best = index;
+    }
+
+public:
+    explicit RuleSet(const std::vector<RuleSpec>& specs) {
+        rules.reserve(specs.size());
+        for (size_t i = 0; i < specs.size(); i++) {
+            const RuleSpec& spec = specs[i];
+            if (spec.limit.maxTokens < 0) {
+                throw std::invalid_argument("maxTokens cannot be negative");
+            }
+            if (spec.limit.window <= 0) {
+                throw std::invalid_argument("window must be positive");
+            }
+            if (spec.limit.block < 0) {
+                throw std::invalid_argument("block cannot be negative");
+            }
+
+            uint32_t index = static_cast<uint32_t>(i);
+            Rule rule;
+            rule.name = spec.name.empty() ? "rule" + std::to_string(i) : spec.name;
+            rule.limit = spec.limit;
+
+            rule.methods = spec.methods.empty() ? kAnyMethod : 0;
+            for (const auto& method : spec.methods) {
+                if (method == "*") {
+                    rule.methods = kAnyMethod;
+                    continue;
+                }
+                uint32_t bit = methodBit(upper(method));
+                if (!bit) {
+                    throw std::invalid_argument("Unknown method in rule: " + method);
+                }
+                rule.methods |= bit;
+            }
+
+            for (const auto& header : spec.headers) {
+                bool anyValue = header.second == "*";
+                rule.headers.push_back({headerIndex(header.first), anyValue,
+                                        anyValue ? 0 : hashOf(header.second), header.second});
+            }
+
+            auto params = insertPath(spec.path.empty() ? "/**" : spec.path, index);
+            rule.key = compileKey(spec.key.empty() ? "{name}:{client}" : spec.key, params);
+            rules.push_back(std::move(rule));
+        }
+    }
+
+    // Lowercase names of the headers any rule reads, in the order match()
+    // expects their values
+    const std::vector<std::string>& headers() const noexcept {
+        return headerNames;
+    }
+
+    // Find the first rule matching the request and build its limiter key.
+    // headerValues is aligned with headers(); a missing header is empty.
+    const RuleLimit* match(std::string_view method, std::string_view path, std::string_view client,
+                           const std::vector<std::string_view>& headerValues, std::string& key) const {
+        thread_local std::vector<std::string_view> segments;
+        thread_local std::vector<size_t> headerHashes;
+        segments.clear();
+        forEachSegment(path, [&](std::string_view segment) { segments.push_back(segment); });
+        headerHashes.clear();
+        for (std::string_view value : headerValues) {
+            headerHashes.push_back(hashOf(value));
+        }
+
+        uint32_t methodMask = methodBit(method);
+        if (!methodMask) methodMask = 0x80000000u;  // Only rules matching any method
+
+        uint32_t best = kNoRule;
+        collect(root, segments, 0, methodMask, headerHashes, headerValues, best);
+        if (best == kNoRule) return nullptr;
+
+        const Rule& rule = rules[best];
+        key.clear();
+        for (const auto& part : rule.key) {
+            switch (part.kind) {
+                case KeyPart::Literal: key += part.text; break;
+                case KeyPart::Name: key += rule.name; break;
+                case KeyPart::Method: key += method; break;
+                case KeyPart::Path: key += path.substr(0, path.find('?')); break;
+                case KeyPart::Client: key += client; break;
+                case KeyPart::Param: key += segments[part.index]; break;
+                case KeyPart::Header: key += headerValues[part.index]; break;
+            }
+        }
+        return &rule.limit;
+    }
+};
@@ -0,0 +1,576 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ratelimiter.hpp"
+
+// Bring a bucket without penalties up to date: the fixed-window and sliding
+// arithmetic of RateLimiter::refillTokens. The bucket is shared with other
+// processes, so every step is a CAS.
+inline void refillBucket(std::atomic<int64_t>& tokens, std::atomic<int64_t>& lastRefill,
+                         int64_t maxTokens, int64_t refillTime, bool sliding, int64_t now) noexcept {
+    int64_t refilled = lastRefill.load(std::memory_order_acquire);
+    int64_t timePassed = now - refilled;
+
+    if (!sliding) {
+        if (timePassed < refillTime) return;
+        if (lastRefill.compare_exchange_strong(refilled, now, std::memory_order_acq_rel)) {
+            tokens.store(maxTokens, std::memory_order_release);
+        }
+        return;
+    }
+
+    int64_t currentTokens = tokens.load(std::memory_order_acquire);
+    int64_t elapsed = 0;
+    if (currentTokens < maxTokens) {
+        int64_t timeToFull = ((maxTokens - currentTokens) * refillTime + maxTokens - 1) / maxTokens;
+        elapsed = std::min(timePassed, timeToFull);
+    }
+    int64_t tokensToAdd = (maxTokens * elapsed) / refillTime;
+    if (tokensToAdd <= 0 && currentTokens < maxTokens) return;
+
+    int64_t refilledAt = now;
+    if (currentTokens + tokensToAdd < maxTokens) {
+        refilledAt = refilled + (tokensToAdd * refillTime + maxTokens - 1) / maxTokens;
+    }
+    if (lastRefill.compare_exchange_strong(refilled, refilledAt, std::memory_order_acq_rel)) {
+        int64_t current = tokens.load(std::memory_order_acquire);
+        while (!tokens.compare_exchange_weak(current, std::min(current + tokensToAdd, maxTokens),
+                   std::memory_order_acq_rel, std::memory_order_acquire)) {
+        }
+    }
+}
+
+// Limiter table in a named POSIX shared-memory segment, so every process on
+// a machine (cluster workers, PM2 instances) enforces the same limits at
+// memory speed, without Redis.
+//
+// Nothing in the segment is a pointer: slots are found by index from the
+// mapping's base, keys are stored inline and every mutable field is a
+// lock-free atomic, which works across processes. Decisions are one or two
+// CAS operations on a slot, so a process dying mid-request cannot leave
+// anything half-done. Creating and removing limiters serializes on a writer
+// lock that survives its owner: on Linux a robust process-shared mutex,
+// which the kernel hands on when its owner dies, whatever pid namespace
+// (container) each process runs in; elsewhere a lock recording its owner's
+// pid, taken over once that pid no longer exists. On Linux a new segment
+// is built under a draft name and linked into place, so no process maps it
+// before its lock is initialized. Slots are published by their state word,
+// written last, so a writer that died mid-insert leaves a claimed slot that
+// the next writer reuses; reconfiguration republishes a live slot under a
+// new version of that word.
+//
+// The table has a fixed capacity chosen by whichever process creates the
+// segment. Time is CLOCK_MONOTONIC milliseconds, which all processes on the
+// machine share, whatever clock the owning limiter uses.
+class SharedMemoryTable {
+public:
+    static constexpr size_t kMaxKeyLength = 70;
+
+    struct Stats {
+        uint64_t totalRequests;
+        uint64_t allowedRequests;
+        uint64_t blockedRequests;
+        uint32_t limiters;
+        uint32_t capacity;
+    };
+
+    // Open name (e.g. "/myapp-limits"), creating it with room for capacity
+    // limiters (rounded up to a power of two) if it does not exist yet
+    SharedMemoryTable(const std::string& name, size_t capacity) {
+#ifdef _WIN32
+        (void)name;
+        (void)capacity;
+        throw std::runtime_error("Shared memory tables are not supported on Windows");
+#else
+        if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != std::string::npos) {
+            throw std::invalid_argument("Shared table name must be '/' followed by a name without '/'");
+        }
+        size_t slots = 64;
+        while (slots < capacity) slots <<= 1;
+
+#ifdef __linux__
+        int fd = openPublished(name, slots);
+        if (fd < 0) {
+            throw std::runtime_error("shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+        struct stat info;
+#else
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size == 0) {
+            // New segment; ftruncate zero-fills, and zero is an empty table
+            if (ftruncate(fd, static_cast<off_t>(sizeof(Header) + slots * sizeof(Slot))) != 0) {
+                int error = errno;
+                close(fd);
+                throw std::runtime_error("Sizing shared table " + name + " failed: " + std::strerror(error));
+            }
+        }
+#endif
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header) + 64 * sizeof(Slot)) {
+            close(fd);
+            throw std::runtime_error("Shared table " + name + " is too small");
+        }
+        mappedSize = static_cast<size_t>(info.st_size);
+        void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Mapping shared table " + name + " failed: " + std::strerror(errno));
+        }
+        header = static_cast<Header*>(base);
+        table = reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(Header));
+
+#ifndef __linux__
+        if (header->magic.load(std::memory_order_acquire) != kMagic) {
+            WriterLock lock(*header);
+            if (header->magic.load(std::memory_order_relaxed) != kMagic) {
+                // Largest power of two that fits the segment, whoever sized it
+                uint32_t fits = 64;
+                while (sizeof(Header) + size_t(fits) * 2 * sizeof(Slot) <= mappedSize) fits <<= 1;
+                header->capacity = fits;
+                header->magic.store(kMagic, std::memory_order_release);
+            }
+        }
+#endif
+        if (header->magic.load(std::memory_order_acquire) != kMagic ||
+            sizeof(Header) + size_t(header->capacity) * sizeof(Slot) > mappedSize) {
+            munmap(base, mappedSize);
+            throw std::runtime_error("Shared table " + name + " has an incompatible layout");
+        }
+        mask = header->capacity - 1;
+#endif
+    }
+
+    ~SharedMemoryTable() {
+#ifndef _WIN32
+        // The segment outlives the mapping; see unlink()
+        if (header) munmap(header, mappedSize);
+#endif
+    }
+
+    SharedMemoryTable(const SharedMemoryTable&) = delete;
+    SharedMemoryTable& operator=(const SharedMemoryTable&) = delete;
+
+    // Remove the segment's name; processes that have it mapped keep using it
+    static bool unlink(const std::string& name) noexcept {
+#ifdef _WIN32
+        (void)name;
+        return false;
+#else
+        return shm_unlink(name.c_str()) == 0;
+#endif
+    }
+
+    static int64_t nowMs() noexcept {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    // Create the limiter, or reconfigure it in place; durations in ms
+    void createLimiter(std::string_view key, int64_t maxTokens, int64_t refillTime,
+                       bool sliding = false, int64_t blockDuration = 0) {
+        if (key.empty()) {
+            throw std::invalid_argument("Key cannot be empty");
+        }
+        if (key.size() > kMaxKeyLength) {
+            throw std::invalid_argument("Shared table keys are limited to 70 bytes");
+        }
+        if (maxTokens < 0) {
+            throw std::invalid_argument("maxTokens cannot be negative");
+        }
+        if (refillTime <= 0) {
+            throw std::invalid_argument("refillTime must be positive");
+        }
+        if (blockDuration < 0) {
+            throw std::invalid_argument("blockDuration cannot be negative");
+        }
+
+        WriterLock lock(*header);
+        const uint32_t hash = hashOf(key);
+        size_t reusable = SIZE_MAX;
+        size_t idx = hash & mask;
+        for (size_t probes = 0; probes <= mask; probes++, idx = (idx + 1) & mask) {
+            Slot& slot = table[idx];
+            uint32_t state = slot.state.load(std::memory_order_acquire);
+            if (kindOf(state) == kLive && matches(slot, hash, key)) {
+                // Republish the configuration under a new version so that
+                // lock-free readers never mix old and new limits. An odd
+                // version was left by a writer that died midway.
+                const uint32_t writing = (state & kVersionStep) ? state : state + kVersionStep;
+                slot.state.store(writing, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.maxTokens.store(maxTokens, std::memory_order_relaxed);
+                slot.refillTime.store(refillTime, std::memory_order_relaxed);
+                slot.blockDuration.store(blockDuration, std::memory_order_relaxed);
+                slot.sliding.store(sliding, std::memory_order_relaxed);
+                slot.tokens.store(maxTokens, std::memory_order_relaxed);
+                slot.lastRefill.store(nowMs(), std::memory_order_relaxed);
+                slot.blockUntil.store(0, std::memory_order_relaxed);
+                slot.state.store(writing + kVersionStep, std::memory_order_release);
+                return;
+            }
+            if (state == kEmpty) {
+                if (reusable == SIZE_MAX) {
+                    // Keep an empty slot at the end of every probe chain
+                    if ((header->used.load(std::memory_order_relaxed) + 1) * 4 > (mask + 1) * 3) {
+                        throw std::length_error("Shared table is full");
+                    }
+                    header->used.fetch_add(1, std::memory_order_relaxed);
+                    reusable = idx;
+                }
+                break;
+            }
+            // Removed, or claimed by a writer that died: reusable
+            if (kindOf(state) != kLive && reusable == SIZE_MAX) reusable = idx;
+        }
+        if (reusable == SIZE_MAX) {
+            throw std::length_error("Shared table is full");
+        }
+
+        Slot& slot = table[reusable];
+        slot.state.store(kClaimed, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.hash = hash;
+        slot.keyLength = static_cast<uint8_t>(key.size());
+        std::memcpy(slot.key, key.data(), key.size());
+        slot.maxTokens.store(maxTokens, std::memory_order_relaxed);
+        slot.refillTime.store(refillTime, std::memory_order_relaxed);
+        slot.blockDuration.store(blockDuration, std::memory_order_relaxed);
+        slot.sliding.store(sliding, std::memory_order_relaxed);
+        slot.tokens.store(maxTokens, std::memory_order_relaxed);
+        slot.lastRefill.store(nowMs(), std::memory_order_relaxed);
+        slot.blockUntil.store(0, std::memory_order_relaxed);
+        slot.state.store(kLive, std::memory_order_release);
+        header->limiters.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void removeLimiter(std::string_view key) {
+        WriterLock lock(*header);
+        if (Slot* slot = find(key)) {
+            slot->state.store(kRemoved, std::memory_order_release);
+            header->limiters.fetch_sub(1, std::memory_order_relaxed);
+            releaseTombstones(static_cast<size_t>(slot - table));
+        }
+    }
+
+    // Unknown keys are rejected, as with RateLimiter::tryRequest
+    bool tryRequest(std::string_view key) noexcept {
+        header->totalRequests.fetch_add(1, std::memory_order_relaxed);
+        Slot* slot = find(key);
+        if (!slot) {
+            header->blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const int64_t now = nowMs();
+        const Config config = configOf(*slot);
+        if (config.blockDuration > 0 && slot->blockUntil.load(std::memory_order_acquire) > now) {
+            header->blockedRequests.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        refill(*slot, config, now);
+        if (tryTakeTokens(slot->tokens, 1, 0, config.maxTokens)) {
+            header->allowedRequests.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (config.blockDuration > 0) {
+            slot->blockUntil.store(now + config.blockDuration, std::memory_order_release);
+        }
+        header->blockedRequests.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Remaining tokens, or -1 for an unknown key
+    int64_t getTokens(std::string_view key) noexcept {
+        Slot* slot = find(key);
+        if (!slot) return -1;
+        refill(*slot, configOf(*slot), nowMs());
+        return std::max(int64_t(0), slot->tokens.load(std::memory_order_acquire));
+    }
+
+    Stats getStats() const noexcept {
+        return Stats{header->totalRequests.load(std::memory_order_relaxed),
+                     header->allowedRequests.load(std::memory_order_relaxed),
+                     header->blockedRequests.load(std::memory_order_relaxed),
+                     header->limiters.load(std::memory_order_relaxed),
+                     header->capacity};
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x48594c53484d0002ull;  // "HYLSHM", layout 2
+
+    // A slot's state word holds its kind in the low byte and a version
+    // above it. Reconfiguring a live key makes the version odd while the
+    // fields are rewritten, so readers take a consistent snapshot of them
+    // (a seqlock) instead of mixing old and new limits.
+    enum State : uint32_t {
+        kEmpty,    // Never used; ends a probe chain
+        kClaimed,  // Being written, or left by a writer that died
+        kLive,
+        kRemoved
+    };
+    static constexpr uint32_t kKindMask = 0xff;
+    static constexpr uint32_t kVersionStep = 0x100;
+
+    static constexpr uint32_t kindOf(uint32_t state) noexcept { return state & kKindMask; }
+
+    struct Config {
+        int64_t maxTokens;
+        int64_t refillTime;
+        int64_t blockDuration;
+        bool sliding;
+    };
+
+    // Every field lives in the segment, so only lock-free atomics will do
+    static_assert(std::atomic<int64_t>::is_always_lock_free, "shared tables need lock-free 64-bit atomics");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared tables need lock-free 32-bit atomics");
+
+    struct alignas(64) Header {
+        std::atomic<uint64_t> magic;
+        uint32_t capacity;
+#ifdef __linux__
+        pthread_mutex_t writerMutex;      // Initialized before the segment is published
+#else
+        std::atomic<int32_t> writer;      // Pid holding the writer lock, 0 when free
+#endif
+        std::atomic<uint32_t> used;       // Slots no longer empty
+        std::atomic<uint32_t> limiters;   // Live limiters
+        std::atomic<uint64_t> totalRequests;
+        std::atomic<uint64_t> allowedRequests;
+        std::atomic<uint64_t> blockedRequests;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> state;
+        uint32_t hash;
+        std::atomic<int64_t> tokens;
+        std::atomic<int64_t> lastRefill;
+        std::atomic<int64_t> blockUntil;
+        std::atomic<int64_t> maxTokens;
+        std::atomic<int64_t> refillTime;
+        std::atomic<int64_t> blockDuration;
+        std::atomic<bool> sliding;
+        uint8_t keyLength;
+        char key[kMaxKeyLength];
+    };
+    static_assert(sizeof(Slot) == 128, "a shared slot is two cache lines");
+
+#ifdef __linux__
+    // Writer lock on a robust process-shared mutex. A pid in another pid
+    // namespace means nothing here, so liveness is left to the kernel: when
+    // the owner dies, the next locker gets EOWNERDEAD and the lock.
+    class WriterLock {
+    public:
+        explicit WriterLock(Header& header) : header(header) {
+            int result = pthread_mutex_lock(&header.writerMutex);
+            if (result == EOWNERDEAD) {
+                // Slots are published last, so a dead writer's half-done insert is reusable
+                pthread_mutex_consistent(&header.writerMutex);
+            } else if (result != 0) {
+                throw std::runtime_error(std::string("Locking shared table failed: ") + std::strerror(result));
+            }
+        }
+
+        ~WriterLock() {
+            pthread_mutex_unlock(&header.writerMutex);
+        }
+
+    private:
+        Header& header;
+    };
+
+    // Open name, creating it if needed. A new segment is built under a
+    // private draft name, with its header and mutex initialized, and then
+    // linked into place, so no process ever maps a half-made table and a
+    // creator dying midway leaves only its draft behind. When another
+    // process publishes first, its segment is used. Returns -1 with errno
+    // set on failure.
+    static int openPublished(const std::string& name, size_t slots) {
+        static std::atomic<uint32_t> drafts{0};
+        for (;;) {
+            int fd = shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd >= 0 || errno != ENOENT) return fd;
+
+            const std::string draft = name + ".draft." + std::to_string(getpid()) + "." +
+                                      std::to_string(drafts.fetch_add(1, std::memory_order_relaxed));
+            fd = shm_open(draft.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0) return -1;
+
+            const size_t size = sizeof(Header) + slots * sizeof(Slot);
+            int linked = -1;
+            if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+                void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (base != MAP_FAILED) {
+                    // ftruncate zero-fills, and zero is an empty table
+                    Header* fresh = static_cast<Header*>(base);
+                    fresh->capacity = static_cast<uint32_t>(slots);
+                    pthread_mutexattr_t attributes;
+                    pthread_mutexattr_init(&attributes);
+                    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+                    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+                    pthread_mutex_init(&fresh->writerMutex, &attributes);
+                    pthread_mutexattr_destroy(&attributes);
+                    fresh->magic.store(kMagic, std::memory_order_release);
+                    munmap(base, size);
+                    // POSIX shared memory lives in /dev/shm on Linux
+                    linked = link(("/dev/shm" + draft).c_str(), ("/dev/shm" + name).c_str());
+                }
+            }
+            const int error = errno;
+            shm_unlink(draft.c_str());
+            if (linked == 0) return fd;
+            close(fd);
+            if (error != EEXIST) {
+                errno = error;
+                return -1;
+            }
+        }
+    }
+#else
+    // Writer lock owned by a pid. Waiters check whether the owner still
+    // exists and take the lock over from a dead one. Threads of one process
+    // share a pid, so they first serialize on a process-local mutex; holding
+    // it, finding our own pid means a previous process with it died holding
+    // the lock.
+    class WriterLock {
+    public:
+        explicit WriterLock(Header& header) : header(header), local(localMutex()) {
+#ifndef _WIN32
+            const int32_t self = static_cast<int32_t>(getpid());
+            for (unsigned spins = 0;; spins++) {
+                int32_t owner = 0;
+                if (header.writer.compare_exchange_strong(owner, self, std::memory_order_acquire)) return;
+                if (owner == self) return;
+                if (spins % 1024 == 1023 && kill(owner, 0) != 0 && errno == ESRCH &&
+                    header.writer.compare_exchange_strong(owner, self, std::memory_order_acquire)) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+#endif
+        }
+
+        ~WriterLock() {
+            header.writer.store(0, std::memory_order_release);
+        }
+
+    private:
+        static std::mutex& localMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        Header& header;
+        std::lock_guard<std::mutex> local;
+    };
+#endif
+
+    Header* header = nullptr;
+    Slot* table = nullptr;
+    size_t mask = 0;
+    size_t mappedSize = 0;
+
+    // FNV-1a: stable across processes and builds, unlike std::hash
+    static uint32_t hashOf(std::string_view key) noexcept {
+        uint32_t hash = 2166136261u;
+        for (char c : key) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    static bool matches(const Slot& slot, uint32_t hash, std::string_view key) noexcept {
+        return slot.hash == hash && slot.keyLength == key.size() &&
+               std::memcmp(slot.key, key.data(), key.size()) == 0;
+    }
+
+    // Empty the tombstones of the run of used slots around idx that no probe
+    // chain still needs. A key's chain runs from its home slot to the slot
+    // holding it, so a tombstone is only needed while a live key after it in
+    // the run has its home at or before it; emptying any other one cannot
+    // hide a key from a lock-free reader. Without this, churn through
+    // distinct keys would fill the table with tombstones. Runs under the
+    // writer lock.
+    void releaseTombstones(size_t idx) noexcept {
+        auto used = [&](size_t i) {
+            return kindOf(table[i & mask].state.load(std::memory_order_relaxed)) != kEmpty;
+        };
+        size_t start = idx;
+        for (size_t n = 0; n < mask && used(start - 1); n++) start = (start - 1) & mask;
+        size_t length = 1;
+        while (length <= mask && used(start + length)) length++;
+
+        // Walk the run backwards, tracking the earliest home (as an offset
+        // from start) of the live keys seen so far
+        size_t earliestHome = SIZE_MAX;
+        for (size_t offset = length; offset-- > 0;) {
+            Slot& slot = table[(start + offset) & mask];
+            if (kindOf(slot.state.load(std::memory_order_relaxed)) == kLive) {
+                earliestHome = std::min(earliestHome, (slot.hash - start) & mask);
+            } else if (offset < earliestHome) {
+                slot.state.store(kEmpty, std::memory_order_release);
+                header->used.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Slot* find(std::string_view key) noexcept {
+        if (key.empty() || key.size() > kMaxKeyLength) return nullptr;
+        const uint32_t hash = hashOf(key);
+        size_t idx = hash & mask;
+        for (size_t probes = 0; probes <= mask; probes++, idx = (idx + 1) & mask) {
+            Slot& slot = table[idx];
+            uint32_t state = slot.state.load(std::memory_order_acquire);
+            if (state == kEmpty) return nullptr;
+            if (kindOf(state) == kLive && matches(slot, hash, key)) return &slot;
+        }
+        return nullptr;
+    }
+
+    // Read the slot's configuration as of one version, retrying while a
+    // writer is between versions. A rewrite is a handful of stores, so a
+    // version that stays odd belongs to a writer that died midway, and its
+    // fields are taken as they are.
+    static Config configOf(const Slot& slot) noexcept {
+        for (unsigned attempts = 0;; attempts++) {
+            const uint32_t before = slot.state.load(std::memory_order_acquire);
+            Config config{slot.maxTokens.load(std::memory_order_relaxed),
+                          slot.refillTime.load(std::memory_order_relaxed),
+                          slot.blockDuration.load(std::memory_order_relaxed),
+                          slot.sliding.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.state.load(std::memory_order_relaxed) == before &&
+                (!(before & kVersionStep) || attempts >= 4096)) {
+                return config;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    static void refill(Slot& slot, const Config& config, int64_t now) noexcept {
+        refillBucket(slot.tokens, slot.lastRefill, config.maxTokens, config.refillTime, config.sliding, now);
+    }
+};
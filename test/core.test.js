@@ -148,6 +148,781 @@ describe('HyperLimit Core Features', () => {
             const reset = limiter.getStats();
             assert.equal(reset.totalRequests, 0);
         });
+
+        it('should count heap key copies only for oversized keys', () => {
+            const key = 'api:tenant-42:GET:/v1/reports/' + 'x'.repeat(64);
+            limiter.createLimiter(key, 1000, 1000);
+
+            const before = limiter.getStats().heapStringCopies;
+            for (let i = 0; i < 1000; i++) {
+                limiter.tryRequest(key, '192.168.100.200');
+                limiter.getTokens(key);
+            }
+            assert.strictEqual(limiter.getStats().heapStringCopies, before);
+
+            limiter.tryRequest('k'.repeat(1000));
+            assert.strictEqual(limiter.getStats().heapStringCopies, before + 1, 'only oversized keys use the heap');
+        });
+    });
+
+    describe('Fair Share', () => {
+        it('should split a shared pool between active tenants', () => {
+            limiter.createLimiter('pool', 100, 60000);
+            limiter.setTenantWeight('pool', 'a', 1);
+            limiter.setTenantWeight('pool', 'b', 1);
+
+            let a = 0;
+            for (let i = 0; i < 200; i++) {
+                if (limiter.tryRequestFairShare('pool', 'a')) a++;
+            }
+            assert.equal(a, 50, 'Bursting tenant should be capped at its share');
+
+            let b = 0;
+            for (let i = 0; i < 200; i++) {
+                if (limiter.tryRequestFairShare('pool', 'b')) b++;
+            }
+            assert.equal(b, 50, 'Second tenant should still get its share');
+        });
+
+        it('should respect tenant weights', () => {
+            limiter.createLimiter('weighted', 100, 60000);
+            limiter.setTenantWeight('weighted', 'big', 3);
+            limiter.setTenantWeight('weighted', 'small', 1);
+
+            const info = limiter.getFairShareInfo('weighted', 'big');
+            assert.equal(info.weight, 3);
+            assert.equal(info.activeWeight, 4);
+            assert.equal(info.share, 75);
+            assert.equal(limiter.getFairShareInfo('weighted', 'small').share, 25);
+        });
+
+        it('should give a lone tenant the whole pool', () => {
+            limiter.createLimiter('solo', 10, 60000);
+
+            let allowed = 0;
+            for (let i = 0; i < 20; i++) {
+                if (limiter.tryRequestFairShare('solo', 'only')) allowed++;
+            }
+            assert.equal(allowed, 10);
+        });
+
+        it('should evict idle tenants and remove them with their pool', () => {
+            const sim = new HyperLimit({ clock: 'manual' });
+            sim.createLimiter('pool', 100, 1000);
+            assert(sim.tryRequestFairShare('pool', 'anonymous'));
+            sim.setTenantWeight('pool', 'registered', 3);
+            assert.strictEqual(sim.getTableStats().limiters, 3);
+
+            sim.advanceTime(600);
+            assert.strictEqual(sim.runMaintenance(undefined, 100).evicted, 0, 'tenants stay for their window');
+            sim.advanceTime(600);
+            sim.runMaintenance(undefined, 100);
+            sim.advanceTime(200);
+            assert.strictEqual(sim.runMaintenance(undefined, 100).evicted, 1);
+            assert.strictEqual(sim.getFairShareInfo('pool', 'registered').weight, 3, 'weighted tenants are pinned');
+
+            assert(sim.tryRequestFairShare('pool', 'anonymous'));
+            sim.removeLimiter('pool');
+            assert.strictEqual(sim.getTableStats().limiters, 0);
+        });
+    });
+
+    describe('Striped Mode', () => {
+        it('should enforce the exact limit across stripes', async () => {
+            limiter.createLimiter('hot', 10, 200);
+            limiter.setStriping('hot', 4, 3);
+
+            let allowed = 0;
+            for (let i = 0; i < 20; i++) {
+                if (limiter.tryRequest('hot')) allowed++;
+            }
+            assert.equal(allowed, 10);
+            assert.equal(limiter.getTokens('hot'), 0);
+
+            await new Promise(resolve => setTimeout(resolve, 250));
+
+            allowed = 0;
+            for (let i = 0; i < 20; i++) {
+                if (limiter.tryRequest('hot')) allowed++;
+            }
+            assert.equal(allowed, 10, 'Stripes should not carry tokens across windows');
+        });
+
+        it('should return held tokens when striping is disabled', () => {
+            limiter.createLimiter('cool', 100, 60000);
+            limiter.setStriping('cool', 8, 10);
+            assert(limiter.tryRequest('cool'));
+            assert.equal(limiter.getTokens('cool'), 99);
+
+            limiter.setStriping('cool', 1);
+            assert.equal(limiter.getTokens('cool'), 99);
+        });
+    });
+
+    describe('Bandwidth Shaping', () => {
+        it('should return the delay that repays byte debt', async () => {
+            limiter.createBandwidthLimiter('bw', 1000, 1000);
+
+            assert.equal(limiter.consumeBytes('bw', 1000), 0, 'Burst should pass without delay');
+            assert.equal(limiter.consumeBytes('bw', 500), 500);
+            assert.equal(limiter.getTokens('bw'), 0, 'A bucket in debt should report empty');
+
+            await new Promise(resolve => setTimeout(resolve, 200));
+            const delay = limiter.consumeBytes('bw', 0);
+            assert(delay > 250 && delay <= 300, `Debt should be repaid at the byte rate, got ${delay}`);
+        });
+
+        it('should reject unknown limiters and negative sizes', () => {
+            assert.throws(() => limiter.consumeBytes('missing', 10), /Unknown limiter/);
+            limiter.createBandwidthLimiter('bw2', 1000);
+            assert.throws(() => limiter.consumeBytes('bw2', -1), /cannot be negative/);
+        });
+
+        it('should let maintenance evict limiters made by ensureBandwidthLimiter', () => {
+            const sim = new HyperLimit({ clock: 'manual' });
+            assert.strictEqual(sim.ensureBandwidthLimiter('bw', 1000, 1000), true);
+            assert.strictEqual(sim.ensureBandwidthLimiter('bw', 1000, 1000), false, 'an up-to-date limiter is kept');
+            assert.strictEqual(sim.consumeBytes('bw', 1500), 500);
+
+            sim.advanceTime(1500);
+            assert.strictEqual(sim.runMaintenance(undefined, 100).evicted, 0, 'idle time starts when first seen idle');
+            sim.advanceTime(100);
+            assert.strictEqual(sim.runMaintenance(undefined, 100).evicted, 1);
+            assert.throws(() => sim.consumeBytes('bw', 10), /Unknown limiter/);
+        });
+    });
+
+    describe('Cost Charging', () => {
+        it('should carry debt into later windows', async () => {
+            limiter.createLimiter('report', 10, 100);
+
+            assert.equal(limiter.charge('report', 25), -15);
+            assert(!limiter.tryRequest('report'), 'A limiter in debt should reject');
+
+            // The first window repays 10 of the 15 tokens owed
+            await new Promise(resolve => setTimeout(resolve, 110));
+            assert(!limiter.tryRequest('report'));
+
+            await new Promise(resolve => setTimeout(resolve, 110));
+            let allowed = 0;
+            for (let i = 0; i < 10; i++) {
+                if (limiter.tryRequest('report')) allowed++;
+            }
+            assert.equal(allowed, 5);
+        });
+
+        it('should reject unknown limiters and negative costs', () => {
+            assert.throws(() => limiter.charge('missing', 1), /Unknown limiter/);
+            limiter.createLimiter('cheap', 10, 1000);
+            assert.throws(() => limiter.charge('cheap', -1), /cannot be negative/);
+        });
+
+        it('should charge local limiters during chargeAsync', async () => {
+            limiter.createLimiter('later', 10, 60000);
+            const charged = limiter.chargeAsync('later', 4);
+            assert.equal(limiter.getTokens('later'), 6, 'charged before the Promise settles');
+            assert.equal(await charged, 6);
+            await assert.rejects(limiter.chargeAsync('missing', 1), /Unknown limiter/);
+        });
+
+        it('should charge aborted responses once', () => {
+            const { EventEmitter } = require('events');
+            const { createCostCharger } = require('../');
+            limiter.createLimiter('aborted', 10, 60000);
+            const track = createCostCharger(limiter, () => 3);
+
+            const finished = new EventEmitter();
+            track({}, finished, 'aborted');
+            finished.emit('finish');
+            finished.emit('close');
+            assert.equal(limiter.getTokens('aborted'), 7, 'finish then close charges once');
+
+            const aborted = new EventEmitter();
+            track({}, aborted, 'aborted');
+            aborted.emit('close');
+            assert.equal(limiter.getTokens('aborted'), 4, 'close without finish still charges');
+        });
+    });
+
+    describe('Connection Handles', () => {
+        it('should limit a handle without a table entry', () => {
+            const handle = limiter.createHandle(3, 1000);
+            const other = limiter.createHandle(3, 1000);
+
+            let allowed = 0;
+            for (let i = 0; i < 5; i++) {
+                if (limiter.consume(handle)) allowed++;
+            }
+            assert.equal(allowed, 3);
+            assert(limiter.consume(other), 'Handles should not share state');
+            assert.throws(() => limiter.consume('handle'), /Wrong arguments/);
+        });
+
+        it('should reject other externals and handles of other instances', () => {
+            assert.throws(() => limiter.consume(limiter.createKeyTable('ipv4', 1, 1000)), TypeError);
+
+            const handle = limiter.createHandle(3, 1000);
+            const other = new HyperLimit({ clock: 'manual' });
+            assert.throws(() => other.consume(handle), /another HyperLimit instance/);
+
+            const attached = new HyperLimit({ shared: limiter.share() });
+            assert(attached.consume(handle), 'instances sharing one limiter share its handles');
+        });
+    });
+
+    describe('Declarative Rules', () => {
+        it('should pick the first matching rule and build its key', () => {
+            limiter.loadRules([
+                { name: 'free', method: 'GET', path: '/reports/:id', headers: { 'X-Tier': 'free' },
+                  key: 'free:{param.id}:{header.x-api-key}', maxTokens: 1, window: 60000 },
+                { name: 'reports', path: '/reports/**', maxTokens: 5, window: 60000 },
+                { name: 'login', method: 'POST', path: '/login', key: '{name}:{client}', maxTokens: 2, window: 60000 }
+            ]);
+
+            const key = limiter.matchRule('GET', '/reports/7?page=2', { 'x-tier': 'free', 'x-api-key': 'abc' }, '1.2.3.4');
+            assert.equal(key, 'free:7:abc');
+            assert(limiter.tryRequest(key));
+            assert(!limiter.tryRequest(key), 'Rule limit should apply to the created limiter');
+            assert.equal(limiter.matchRule('GET', '/reports/7', { 'x-tier': 'free', 'x-api-key': 'abc' }, '1.2.3.4'), key);
+            assert.equal(limiter.getTokens(key), 0, 'Matching again should keep the limiter state');
+
+            assert.equal(limiter.matchRule('DELETE', '/reports/7', {}, '1.2.3.4'), 'reports:1.2.3.4');
+            assert.equal(limiter.matchRule('POST', '/login', {}, '5.6.7.8'), 'login:5.6.7.8');
+            assert.equal(limiter.matchRule('GET', '/login', {}, '5.6.7.8'), null);
+        });
+
+        it('should reject invalid rules', () => {
+            assert.throws(() => limiter.loadRules([{ path: '/a/**/b', maxTokens: 1, window: 1000 }]), /last segment/);
+            assert.throws(() => limiter.loadRules([{ path: '/a/:id', key: '{param.x}', maxTokens: 1, window: 1000 }]), /unknown path parameter/);
+            assert.throws(() => limiter.loadRules([{ method: 'BREW', maxTokens: 1, window: 1000 }]), /Unknown method/);
+        });
+    });
+
+    describe('Clock Source', () => {
+        it('should refill with every clock source', async () => {
+            for (const clock of ['steady', 'coarse', 'cached', 'tsc']) {
+                const clocked = new HyperLimit({ clock });
+                clocked.createLimiter('clocked', 2, 50);
+                assert(clocked.tryRequest('clocked'));
+                assert(clocked.tryRequest('clocked'));
+                assert(!clocked.tryRequest('clocked'), `${clock}: limit should apply`);
+
+                await new Promise(resolve => setTimeout(resolve, 70));
+                assert(clocked.tryRequest('clocked'), `${clock}: window should refill`);
+            }
+        });
+
+        it('should support sub-millisecond windows at microsecond resolution', async () => {
+            const fine = new HyperLimit({ clock: 'tsc', resolution: 'us' });
+            assert(['tsc', 'steady'].includes(fine.getClock().source));
+            assert.strictEqual(fine.getClock().resolution, 'us');
+
+            fine.createLimiter('fine', 2, 0.5);
+            assert(fine.tryRequest('fine'));
+            assert(fine.tryRequest('fine'));
+            assert(!fine.tryRequest('fine'));
+
+            await new Promise(resolve => setTimeout(resolve, 2));
+            assert(fine.tryRequest('fine'), 'a 0.5ms window should have refilled');
+
+            const start = fine.now();
+            await new Promise(resolve => setTimeout(resolve, 5));
+            assert(fine.now() - start >= 4);
+        });
+
+        it('should only move the manual clock on advanceTime', () => {
+            const sim = new HyperLimit({ clock: 'manual' });
+            sim.createLimiter('sim', 2, 1000, false, 5000);
+            assert.strictEqual(sim.now(), 0);
+
+            assert(sim.tryRequest('sim'));
+            assert(sim.tryRequest('sim'));
+            assert(!sim.tryRequest('sim'));
+
+            assert.strictEqual(sim.advanceTime(4999), 4999);
+            assert(!sim.tryRequest('sim'), 'still blocked');
+            sim.advanceTime(1);
+            assert(sim.tryRequest('sim'), 'block expired and window refilled');
+
+            assert.throws(() => sim.advanceTime(-1), /backwards/);
+            assert.throws(() => limiter.advanceTime(1), /manual clock/);
+        });
+
+        it('should reject unknown clock sources', () => {
+            assert.throws(() => new HyperLimit({ clock: 'sundial' }), /clock must be/);
+        });
+    });
+
+    describe('Maintenance', () => {
+        it('should clear expired blocks and evict idle rule limiters', () => {
+            const sim = new HyperLimit({ clock: 'manual' });
+            sim.createLimiter('pinned', 1, 1000, false, 500);
+            sim.loadRules([{ name: 'api', path: '/api/**', maxTokens: 2, window: 1000 }]);
+            const key = sim.matchRule('GET', '/api/items', {}, '1.2.3.4');
+
+            assert(sim.tryRequest('pinned'));
+            assert(!sim.tryRequest('pinned'));
+            assert(sim.tryRequest(key));
+
+            sim.advanceTime(1000);
+            let result = sim.runMaintenance(undefined, 500);
+            assert.strictEqual(result.swept, 2);
+            assert.strictEqual(result.unblocked, 1);
+            assert.strictEqual(result.evicted, 0, 'idle time starts when first seen idle');
+
+            sim.advanceTime(500);
+            result = sim.runMaintenance(undefined, 500);
+            assert.strictEqual(result.evicted, 1);
+            assert.strictEqual(sim.getTokens(key), -1);
+            assert.strictEqual(sim.getTokens('pinned'), 1, 'explicit limiters are never evicted');
+
+            assert.strictEqual(sim.matchRule('GET', '/api/items', {}, '1.2.3.4'), key);
+            assert(sim.tryRequest(key), 'matchRule recreates an evicted limiter');
+        });
+
+        it('should keep probes short while evicted limiters churn through the table', () => {
+            const sim = new HyperLimit({ clock: 'manual', bucketCount: 1024 });
+            sim.loadRules([{ name: 'api', path: '/api/**', maxTokens: 2, window: 1000 }]);
+
+            for (let round = 0; round < 20; round++) {
+                for (let i = 0; i < 300; i++) {
+                    const key = sim.matchRule('GET', '/api/items', {}, `10.0.${round}.${i}`);
+                    assert(sim.tryRequest(key));
+                }
+                const stats = sim.getTableStats();
+                assert.strictEqual(stats.limiters, 300);
+                assert((stats.limiters + stats.tombstones) * 2 <= stats.capacity, 'tombstones count toward the load factor');
+                assert(stats.capacity <= 2048, 'tombstones are dropped rather than grown around');
+                assert(stats.maxProbeLength <= 64, `probe length ${stats.maxProbeLength} in round ${round}`);
+
+                sim.advanceTime(1000);
+                sim.runMaintenance(undefined, 500);
+                sim.advanceTime(500);
+                assert.strictEqual(sim.runMaintenance(undefined, 500).evicted, 300);
+            }
+        });
+
+        it('should run in the background when configured', async () => {
+            const maintained = new HyperLimit({ maintenance: { interval: 5, batch: 64 } });
+            maintained.createLimiter('bg', 1, 20, false, 10);
+            assert(maintained.tryRequest('bg'));
+            assert(!maintained.tryRequest('bg'));
+
+            await new Promise(resolve => setTimeout(resolve, 40));
+            assert.strictEqual(maintained.getTokens('bg'), 1, 'the sweep refilled the bucket');
+            assert(maintained.tryRequest('bg'));
+        });
+    });
+
+    describe('Limiter Ids', () => {
+        it('should limit by id and reject ids of removed limiters', () => {
+            const id = limiter.createLimiter('route', 2, 1000, false, 0, 0, '', true);
+            assert.strictEqual(typeof id, 'number');
+            assert.strictEqual(limiter.createLimiter('route', 2, 1000, false, 0, 0, '', true), id);
+
+            assert(limiter.tryRequestById(id));
+            assert(limiter.tryRequestById(id));
+            assert(!limiter.tryRequestById(id));
+            assert.strictEqual(limiter.getTokensById(id), 0);
+            assert.strictEqual(limiter.getInfoById(id).limit, 2);
+            assert.strictEqual(limiter.getTokens('route'), 0, 'ids and keys share the limiter');
+
+            limiter.removeLimiter('route');
+            assert(!limiter.tryRequestById(id));
+            const reused = limiter.createLimiter('other', 5, 1000, false, 0, 0, '', true);
+            assert.notStrictEqual(reused, id);
+            assert.strictEqual(limiter.getTokensById(id), -1, 'a stale id stays rejected');
+            assert.strictEqual(limiter.getTokensById(reused), 5);
+            assert.throws(() => limiter.tryRequestById('route'), /Wrong arguments/);
+        });
+    });
+
+    describe('Batch Decisions', () => {
+        it('should decide on many keys in one call', () => {
+            limiter.createLimiter('a', 3, 1000);
+            limiter.createLimiter('b', 1, 1000);
+
+            let results = limiter.tryRequestBatch(['a', 'b', 'b', 'missing']);
+            assert(results instanceof Uint8Array);
+            assert.deepStrictEqual(Array.from(results), [1, 1, 0, 0]);
+
+            results = limiter.tryRequestBatch(Buffer.from('a\nb\na'), [1, 1, 2]);
+            assert.deepStrictEqual(Array.from(results), [1, 0, 0]);
+            assert.strictEqual(limiter.getTokens('a'), 1);
+
+            assert.throws(() => limiter.tryRequestBatch(['a'], [1, 2]), /one entry per key/);
+            assert.throws(() => limiter.tryRequestBatch('a'), /Wrong arguments/);
+        });
+    });
+
+    describe('Decision Info', () => {
+        it('should write the decision and info into the registered array', () => {
+            const info = new Float64Array(5);
+            const reporting = new HyperLimit({ infoArray: info });
+            reporting.createLimiter('api', 2, 1000, false, 5000);
+
+            assert.strictEqual(reporting.tryRequestInfo('api'), true);
+            assert.deepStrictEqual(Array.from(info.subarray(0, 3)), [1, 2, 1]);
+            assert(reporting.tryRequestInfo('api'));
+            assert.strictEqual(reporting.tryRequestInfo('api'), false);
+            assert.strictEqual(info[0], 0);
+            assert.strictEqual(info[2], 0);
+            assert(info[4] >= 4, 'blocked requests report retryAfter');
+            const nowSeconds = Math.floor(Date.now() / 1000);
+            assert(info[3] >= nowSeconds && info[3] <= nowSeconds + 2, 'reset is a Unix time');
+
+            reporting.createLimiter('empty', 1, 30000);
+            reporting.tryRequestInfo('empty');
+            assert.strictEqual(reporting.tryRequestInfo('empty'), false);
+            assert.strictEqual(info[4], 30, 'an empty bucket retries at the next token');
+
+            const info64 = new BigInt64Array(5);
+            const exact = new HyperLimit({ infoArray: info64 });
+            exact.createLimiter('api', 3, 1000);
+            exact.tryRequestInfo('api');
+            assert.strictEqual(info64[2], 2n);
+
+            assert.throws(() => limiter.tryRequestInfo('api'), /infoArray/);
+            assert.throws(() => new HyperLimit({ infoArray: new Float64Array(2) }), /infoArray/);
+        });
+    });
+
+    describe('Integer-Keyed Tables', () => {
+        it('should limit each integer key separately', () => {
+            const perIp = limiter.createKeyTable('ipv4', 2, 1000);
+            assert(limiter.tryRequestKey(perIp, '10.0.0.1'));
+            assert(limiter.tryRequestKey(perIp, 0x0a000001));
+            assert(!limiter.tryRequestKey(perIp, Buffer.from([10, 0, 0, 1])), 'all forms name the same key');
+            assert(limiter.tryRequestKey(perIp, '10.0.0.2'));
+            assert.strictEqual(limiter.getKeyTokens(perIp, '10.0.0.2'), 1);
+            assert.strictEqual(limiter.getKeyTokens(perIp, '10.0.0.3'), 2, 'unseen keys have the full limit');
+            assert.throws(() => limiter.tryRequestKey(perIp, '::1'), /Invalid key/);
+
+            const dualStack = limiter.createKeyTable('ipv6', 1, 1000);
+            assert(limiter.tryRequestKey(dualStack, '192.0.2.1'));
+            assert(!limiter.tryRequestKey(dualStack, '::ffff:192.0.2.1'));
+            assert(limiter.tryRequestKey(dualStack, HyperLimit.parseIp('2001:db8::1')));
+            assert(!limiter.tryRequestKey(dualStack, 0x20010db8000000000000000000000001n));
+
+            const perUser = limiter.createKeyTable('u64', 1, 1000);
+            assert(limiter.tryRequestKey(perUser, 42));
+            assert(!limiter.tryRequestKey(perUser, 42n));
+            assert.throws(() => limiter.tryRequestKey(perUser, -1), /Invalid key/);
+            assert.throws(() => limiter.createKeyTable('u16', 1, 1000), /type must be/);
+        });
+
+        it('should reject other externals and tables of other instances', () => {
+            assert.throws(() => limiter.tryRequestKey(limiter.createHandle(1, 1000), 1), TypeError);
+            assert.throws(() => limiter.getKeyTokens({}, 1), /Wrong arguments/);
+
+            const perUser = limiter.createKeyTable('u64', 1, 1000);
+            const other = new HyperLimit({ clock: 'manual' });
+            assert.throws(() => other.tryRequestKey(perUser, 42), /another HyperLimit instance/);
+        });
+
+        it('should parse textual addresses', () => {
+            assert.deepStrictEqual(HyperLimit.parseIp('127.0.0.1'), Buffer.from([127, 0, 0, 1]));
+            assert.strictEqual(HyperLimit.parseIp('::1').length, 16);
+            assert.strictEqual(HyperLimit.parseIp('::1')[15], 1);
+            assert.strictEqual(HyperLimit.parseIp('256.0.0.1'), null);
+            assert.strictEqual(HyperLimit.parseIp('1::2::3'), null);
+        });
+    });
+
+    describe('Shared Limiters', () => {
+        it('should share one limiter with a worker thread', async () => {
+            const { Worker } = require('worker_threads');
+            limiter.createLimiter('shared', 10, 60000);
+            const token = limiter.share();
+            assert.strictEqual(limiter.share(), token, 'sharing again returns the same token');
+
+            const allowed = await new Promise((resolve, reject) => {
+                const worker = new Worker(`
+                    const { parentPort, workerData } = require('worker_threads');
+                    const { HyperLimit } = require(workerData.module);
+                    const limiter = new HyperLimit({ shared: workerData.token });
+                    let allowed = 0;
+                    for (let i = 0; i < 4; i++) allowed += limiter.tryRequest('shared') ? 1 : 0;
+                    parentPort.postMessage(allowed);
+                `, { eval: true, workerData: { token, module: require.resolve('../') } });
+                worker.once('message', resolve);
+                worker.once('error', reject);
+            });
+
+            assert.strictEqual(allowed, 4);
+            assert.strictEqual(limiter.getTokens('shared'), 6, 'the worker drew from the same bucket');
+            assert.throws(() => new HyperLimit({ shared: 999999 }), /shared must be a token/);
+        });
+
+        it('should stay exact while keys are created and removed under concurrent requests', async () => {
+            const { Worker } = require('worker_threads');
+            const table = new HyperLimit({ bucketCount: 1024 });
+            table.createLimiter('budget', 2000, 3600000);
+            table.createLimiter('striped', 2000, 3600000);
+            table.setStriping('striped', 8);
+            const stop = new Int32Array(new SharedArrayBuffer(4));
+
+            const workers = Array.from({ length: 3 }, () => new Worker(`
+                const { parentPort, workerData } = require('worker_threads');
+                const { HyperLimit } = require(workerData.module);
+                const limiter = new HyperLimit({ shared: workerData.token });
+                let budget = 0, striped = 0, i = 0;
+                parentPort.postMessage('ready');
+                while (!Atomics.load(workerData.stop, 0) ||
+                       limiter.getTokens('budget') > 0 || limiter.getTokens('striped') > 0) {
+                    budget += limiter.tryRequest('budget') ? 1 : 0;
+                    striped += limiter.tryRequest('striped') ? 1 : 0;
+                    limiter.tryRequest('churn' + (i++ % 2048));
+                }
+                parentPort.postMessage({ budget, striped });
+            `, { eval: true, workerData: { token: table.share(), module: require.resolve('../'), stop } }));
+            const results = workers.map(worker => new Promise((resolve, reject) => {
+                worker.on('message', message => message !== 'ready' && resolve(message));
+                worker.once('error', reject);
+            }));
+            await Promise.all(workers.map(worker => new Promise(resolve => worker.once('message', resolve))));
+
+            // Grows the table, reuses tombstones and replaces limiters while
+            // the workers look them up
+            for (let round = 0; round < 8; round++) {
+                for (let i = 0; i < 2048; i++) table.createLimiter('churn' + i, 10, 1000);
+                for (let i = 0; i < 2048; i += 2) table.createLimiter('churn' + i, 20, 1000, true);
+                for (let i = 0; i < 2048; i++) table.removeLimiter('churn' + i);
+            }
+            Atomics.store(stop, 0, 1);
+
+            const counts = await Promise.all(results);
+            assert.strictEqual(counts.reduce((sum, c) => sum + c.budget, 0), 2000, 'no consume was lost');
+            assert.strictEqual(counts.reduce((sum, c) => sum + c.striped, 0), 2000);
+        });
+    });
+
+    describe('Shared Memory Tables', () => {
+        const name = `/hyperlimit-test-${process.pid}`;
+        afterEach(() => HyperLimit.unlinkSharedTable(name));
+
+        it('should enforce one limit through every mapping of a table', function () {
+            if (process.platform === 'win32') this.skip();
+            const first = limiter.openSharedTable(name, 100);
+            const second = limiter.openSharedTable(name);
+            limiter.createSharedLimiter(first, 'api', 3, 60000);
+
+            assert(limiter.tryRequestShared(first, 'api'));
+            assert(limiter.tryRequestShared(second, 'api'));
+            assert(limiter.tryRequestShared(first, 'api'));
+            assert(!limiter.tryRequestShared(second, 'api'));
+            assert.strictEqual(limiter.getSharedTokens(second, 'api'), 0);
+            assert.strictEqual(limiter.getSharedTokens(first, 'missing'), -1);
+
+            const stats = limiter.getSharedStats(second);
+            assert.strictEqual(stats.capacity, 128);
+            assert.strictEqual(stats.limiters, 1);
+            assert.strictEqual(stats.allowedRequests, 3);
+            assert.strictEqual(stats.blockedRequests, 1);
+
+            limiter.removeSharedLimiter(first, 'api');
+            assert(!limiter.tryRequestShared(second, 'api'));
+            assert.throws(() => limiter.createSharedLimiter(first, 'x'.repeat(71), 1, 1000), /70 bytes/);
+        });
+
+        it('should reuse the slots of removed limiters', function () {
+            if (process.platform === 'win32') this.skip();
+            const table = limiter.openSharedTable(name, 64);
+            limiter.createSharedLimiter(table, 'keep', 1, 60000);
+
+            for (let i = 0; i < 5000; i++) {
+                limiter.createSharedLimiter(table, `churn-${i}`, 1, 60000);
+                limiter.removeSharedLimiter(table, `churn-${i}`);
+            }
+            assert.strictEqual(limiter.getSharedStats(table).limiters, 1);
+            assert.strictEqual(limiter.getSharedTokens(table, 'keep'), 1);
+        });
+
+        it('should reject externals that are not shared tables', () => {
+            const perIp = limiter.createKeyTable('ipv4', 1, 1000);
+            assert.throws(() => limiter.createSharedLimiter(perIp, 'api', 3, 60000), TypeError);
+            assert.throws(() => limiter.tryRequestShared(limiter.createHandle(1, 1000), 'api'), TypeError);
+            assert.throws(() => limiter.getSharedStats({}), /Wrong arguments/);
+        });
+    });
+
+    describe('Async Requests', () => {
+        it('should settle local decisions like tryRequest', async () => {
+            limiter.createLimiter('async', 2, 60000);
+            assert.strictEqual(await limiter.tryRequestAsync('async'), true);
+            assert.strictEqual(await limiter.tryRequestAsync('async'), true);
+            assert.strictEqual(await limiter.tryRequestAsync('async'), false);
+            assert.strictEqual(await limiter.tryRequestAsync('missing'), false);
+
+            const info = await limiter.getRateLimitInfoAsync('async');
+            assert.strictEqual(info.limit, 2);
+            assert.strictEqual(info.remaining, 0);
+        });
+    });
+
+    describe('Events', () => {
+        afterEach(() => limiter.offEvents());
+
+        it('should deliver block, unblock and penalty transitions in batches', async () => {
+            const manual = new HyperLimit({ clock: 'manual' });
+            manual.createLimiter('evt', 1, 1000, false, 500, 10);
+            const batches = [];
+            manual.onEvents((events, dropped) => batches.push({ events, dropped }), { interval: 10 });
+
+            assert(manual.tryRequest('evt'));
+            assert(!manual.tryRequest('evt'));
+            manual.addPenalty('evt', 2);
+            manual.advanceTime(600);
+            manual.runMaintenance();
+            await new Promise(resolve => setTimeout(resolve, 50));
+            manual.offEvents();
+
+            const events = batches.flatMap(batch => batch.events);
+            assert.deepStrictEqual(events.map(e => e.type), ['block', 'penalty', 'unblock']);
+            assert.strictEqual(events[0].key, 'evt');
+            assert.strictEqual(events[0].until, 500);
+            assert.strictEqual(events[1].points, 2);
+            assert.strictEqual(events[2].time, 600);
+            assert(batches.every(batch => batch.dropped === 0));
+        });
+
+        it('should give every subscriber of a shared limiter its own events', async () => {
+            const manual = new HyperLimit({ clock: 'manual' });
+            manual.createLimiter('evt', 1, 1000, false, 500);
+            const attached = new HyperLimit({ shared: manual.share() });
+            const first = [];
+            const second = [];
+            manual.onEvents(events => first.push(...events), { interval: 10 });
+            attached.onEvents(events => second.push(...events), { interval: 10 });
+
+            assert(manual.tryRequest('evt'));
+            assert(!manual.tryRequest('evt'));
+            await new Promise(resolve => setTimeout(resolve, 50));
+            attached.offEvents();
+
+            manual.advanceTime(600);
+            manual.runMaintenance();
+            await new Promise(resolve => setTimeout(resolve, 50));
+            manual.offEvents();
+
+            assert.deepStrictEqual(first.map(e => e.type), ['block', 'unblock'], 'offEvents elsewhere does not silence this one');
+            assert.deepStrictEqual(second.map(e => e.type), ['block']);
+        });
+    });
+
+    describe('Bulk Introspection', () => {
+        it('should report many keys in one struct-of-arrays', () => {
+            limiter.createLimiter('bulk1', 5, 60000);
+            limiter.createLimiter('bulk2', 8, 60000);
+            limiter.tryRequest('bulk2');
+
+            const info = limiter.getInfoMany(['bulk1', 'bulk2', 'missing']);
+            assert.strictEqual(info.length, 18);
+            assert.deepStrictEqual(Array.from(info.subarray(0, 3)), [5, 8, -1]);
+            assert.deepStrictEqual(Array.from(info.subarray(3, 6)), [5, 7, -1]);
+            assert.deepStrictEqual(Array.from(info.subarray(9, 12)), [0, 0, 0]);
+            assert(Math.abs(info[15] - (Date.now() + 60000)) < 5000, 'resetAt is a Unix time in ms');
+            assert.strictEqual(info[17], 0);
+
+            const into = new Float64Array(15);
+            assert.strictEqual(limiter.getInfoMany(Buffer.from('bulk1\nbulk2\nmissing'), into), into);
+            assert.strictEqual(into[4], 7);
+            assert.throws(() => limiter.getInfoMany(['bulk1'], new Float64Array(4)), RangeError);
+        });
+
+        it('should write stats into a caller buffer', () => {
+            limiter.createLimiter('stats', 1, 60000);
+            limiter.tryRequest('stats');
+            limiter.tryRequest('stats');
+
+            const into = new Float64Array(8);
+            assert.strictEqual(limiter.getStats(into), into);
+            const stats = limiter.getStats();
+            assert.strictEqual(into[0], stats.totalRequests);
+            assert.strictEqual(into[1], stats.allowedRequests);
+            assert.strictEqual(into[2], stats.blockedRequests);
+            assert.strictEqual(into[5], stats.blockRate);
+        });
+    });
+
+    describe('Middleware Decisions', () => {
+        it('should bypass, create, decide and report header values in one call', () => {
+            const info = new Float64Array(5);
+            const deciding = new HyperLimit({ infoArray: info });
+            deciding.configureDecide({ bypassKeys: ['secret'], maxTokens: 2, window: 30000 });
+
+            assert.strictEqual(deciding.decide('client', '1.2.3.4', 'secret'), 2);
+            assert.strictEqual(deciding.getTokens('client'), -1, 'a bypass creates and counts nothing');
+
+            assert.strictEqual(deciding.decide('client', '1.2.3.4', 'wrong'), 1);
+            assert.deepStrictEqual(Array.from(info.subarray(0, 3)), [1, 2, 1]);
+            const nowSeconds = Date.now() / 1000;
+            assert(info[3] >= nowSeconds && info[3] <= nowSeconds + 31, 'reset is a Unix time');
+            assert.strictEqual(deciding.decide('client'), 1);
+            assert.strictEqual(deciding.decide('client'), 0);
+            assert.strictEqual(info[2], 0);
+            assert.strictEqual(info[4], 30, 'fixed-window rejections retry at the reset');
+        });
+
+        it('should retry after the next token or the rest of a block, rounded up', () => {
+            const info = new Float64Array(6);
+            const deciding = new HyperLimit({ infoArray: info, clock: 'manual' });
+            deciding.createLimiter('sliding', 10, 60000, true);
+            deciding.createLimiter('blocking', 1, 60000, false, 1500);
+
+            for (let i = 0; i < 10; i++) assert.strictEqual(deciding.decide('sliding'), 1);
+            assert.strictEqual(deciding.decide('sliding'), 0);
+            assert.strictEqual(info[4], 6, 'a sliding window refills one token every window / limit');
+
+            assert.strictEqual(deciding.decide('blocking'), 1);
+            assert.strictEqual(deciding.decide('blocking'), 0);
+            assert.strictEqual(info[4], 2);
+            deciding.advanceTime(1200);
+            assert.strictEqual(deciding.decide('blocking'), 0);
+            assert.strictEqual(info[4], 1, 'under a second of block left rounds up');
+            assert(Math.abs(info[5] - (Date.now() + 60000)) < 5000, 'resetAt is a Unix time in ms');
+
+            const limitInfo = deciding.getRateLimitInfo('blocking');
+            assert.strictEqual(limitInfo.retryAfter, 1);
+            assert.strictEqual(limitInfo.resetAt, info[5]);
+        });
+
+        it('should write cached legacy and standard header strings', () => {
+            const headers = new Array(5);
+            const deciding = new HyperLimit();
+            deciding.configureDecide({ maxTokens: 1, window: 60000, headers, standardHeaders: true });
+
+            assert.strictEqual(deciding.decide('client'), 1);
+            assert.deepStrictEqual(headers.slice(0, 2), ['1', '0']);
+            assert(Math.abs(Number(headers[2]) - (Date.now() / 1000 + 60)) <= 2);
+            assert.strictEqual(headers[3], '"default";q=1;w=60');
+            assert.match(headers[4], /^"default";r=0;t=(59|60)$/);
+
+            assert.strictEqual(deciding.decide('client'), 0);
+            const rejected = headers.slice();
+            assert.strictEqual(deciding.decide('client'), 0);
+            assert.deepStrictEqual(headers, rejected);
+
+            const legacyOff = new Array(5);
+            deciding.configureDecide({ maxTokens: 1, window: 60000, headers: legacyOff, legacyHeaders: false });
+            deciding.decide('other');
+            assert.deepStrictEqual(legacyOff.slice(0, 3), [undefined, undefined, undefined]);
+            assert.strictEqual(legacyOff[3], undefined, 'standard headers are off by default');
+        });
+
+        it('should not mix up header values that share a packed key', () => {
+            const headers = new Array(5);
+            const deciding = new HyperLimit();
+            deciding.configureDecide({ headers, standardHeaders: true });
+            // (1 << 32) ^ 1 === (0 << 32) ^ (2 ** 32 + 1)
+            deciding.createLimiter('small', 1, 1000);
+            deciding.createLimiter('huge', 0, (2 ** 32 + 1) * 1000);
+
+            deciding.decide('small');
+            assert.strictEqual(headers[3], '"default";q=1;w=1');
+            deciding.decide('huge');
+            assert.strictEqual(headers[3], '"default";q=0;w=4294967297');
+        });
     });
 
     describe('IP Whitelist/Blacklist', () => {
@@ -282,6 +282,112 @@ describe('Express Middleware', () => {
         });
     });
 
+    describe('Declarative Rules', () => {
+        it('should limit requests by the matching rule', async () => {
+            const app = express();
+            app.use(rateLimit({
+                key: 'rules-default',
+                maxTokens: 100,
+                window: '1m',
+                rules: [
+                    { method: 'POST', path: '/login', maxTokens: 2, window: '1m' },
+                    { path: '/api/:tenant/**', key: 'tenant:{param.tenant}', maxTokens: 1, window: '1m' }
+                ]
+            }));
+            app.all('*', (req, res) => res.json({ message: 'success' }));
+
+            assert.strictEqual((await request(app).post('/login')).status, 200);
+            assert.strictEqual((await request(app).post('/login')).status, 200);
+            assert.strictEqual((await request(app).post('/login')).status, 429);
+
+            assert.strictEqual((await request(app).get('/api/acme/items')).status, 200);
+            assert.strictEqual((await request(app).get('/api/acme/users')).status, 429);
+            assert.strictEqual((await request(app).get('/api/globex/items')).status, 200);
+
+            // No rule matches: the regular limiter applies
+            assert.strictEqual((await request(app).get('/health')).status, 200);
+        });
+
+        it('should evict idle rule limiters', async () => {
+            const app = express();
+            let limiter;
+            app.use(rateLimit({
+                key: 'rules-evict-default',
+                rules: [{ path: '/api/**', key: 'evict:{client}', maxTokens: 5, window: '50ms' }],
+                maintenance: { interval: 10, idleTimeout: 20 }
+            }));
+            app.all('*', (req, res) => {
+                limiter = req.rateLimit.limiter;
+                res.json({ message: 'success' });
+            });
+
+            assert.strictEqual((await request(app).get('/api/items')).status, 200);
+            assert.strictEqual(limiter.getTableStats().limiters, 2, 'the default limiter and one rule limiter');
+
+            await new Promise(resolve => setTimeout(resolve, 300));
+            assert.strictEqual(limiter.getTableStats().limiters, 1, 'only the default limiter is left');
+        });
+    });
+
+    describe('Bandwidth Shaping', () => {
+        it('should pace response bodies to the download rate', async () => {
+            const app = express();
+            const delays = [];
+            app.get('/download', rateLimit({
+                key: 'download',
+                maxTokens: 10,
+                window: '1s',
+                // Frozen time: no refill between chunks, so each delay is exact
+                clock: 'manual',
+                bandwidth: { download: 20000, burst: 5000 }
+            }), (req, res) => {
+                const { limiter } = req.rateLimit;
+                const consumeBytes = limiter.consumeBytes;
+                limiter.consumeBytes = (key, bytes) => {
+                    assert(key.startsWith('bandwidth\x1f'), 'shaper keys are kept apart from user keys');
+                    const delay = consumeBytes.call(limiter, key, bytes);
+                    delays.push(delay);
+                    return delay;
+                };
+                for (let i = 0; i < 5; i++) {
+                    res.write(Buffer.alloc(5000));
+                }
+                res.end();
+            });
+
+            const res = await request(app).get('/download').responseType('blob');
+
+            assert.strictEqual(res.status, 200);
+            assert.strictEqual(res.body.length, 25000);
+            // The burst passes at once; each further 5000 bytes waits 250ms
+            // longer at 20000 bytes per second
+            assert.deepStrictEqual(delays, [0, 250, 500, 750, 1000]);
+        });
+    });
+
+    describe('Cost Charging', () => {
+        it('should charge the cost of a finished response', async () => {
+            const app = express();
+            app.get('/report', rateLimit({
+                key: 'report',
+                maxTokens: 6,
+                window: '1m',
+                sliding: false,
+                cost: (req, res, durationMs) => (res.statusCode === 200 ? 5 : 0)
+            }), (req, res) => {
+                res.json({ message: 'success' });
+            });
+
+            const first = await request(app).get('/report');
+            assert.strictEqual(first.status, 200);
+            await new Promise(resolve => setTimeout(resolve, 20));
+
+            // 1 token for the request plus 5 charged afterwards
+            const second = await request(app).get('/report');
+            assert.strictEqual(second.status, 429);
+        });
+    });
+
     describe('Distributed Rate Limiting', () => {
         it('should share rate limits across multiple Express instances with NATS', async function() {
             // Skip if NATS server not available
@@ -56,6 +56,20 @@ describe('RateLimiter Edge Cases', () => {
         assert(info.remaining >= 7); // At least 7 tokens (5 used, ~2-3 refilled)
     });
 
+    it('should find every key in a crowded table', () => {
+        const small = new HyperLimit({ bucketCount: 1024 });
+        for (let i = 0; i < 3000; i++) {
+            small.createLimiter(`crowded-${i}`, 2, 1000);
+        }
+        for (let i = 0; i < 3000; i += 2) {
+            small.removeLimiter(`crowded-${i}`);
+        }
+
+        for (let i = 0; i < 3000; i++) {
+            assert.equal(small.tryRequest(`crowded-${i}`), i % 2 === 1, `Unexpected result for crowded-${i}`);
+        }
+    });
+
     it('should handle memory ordering in updates', () => {
         limiter.createLimiter('test-ordering', 5, 1000); // 5 tokens/sec
         